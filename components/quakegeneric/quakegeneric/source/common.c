@@ -1156,6 +1156,7 @@ void COM_Init (char *basedir)
 	Cvar_RegisterVariable (&registered);
 	Cvar_RegisterVariable (&cmdline);
 	Cmd_AddCommand ("path", COM_Path_f);
+	Cmd_AddCommand ("iostats", Sys_FileStats);
 
 	COM_InitFilesystem ();
 	COM_CheckRegistered ();
@@ -1542,6 +1543,9 @@ byte *COM_LoadFile (char *path, int usehunk)
 	if (h == -1)
 		return NULL;
 	
+// the whole file is read in one go, and nothing after it
+	Sys_FileReadAhead (h, len);
+
 // extract the filename base name for hunk tag
 	COM_FileBase (path, base, 32);
 	
@@ -1560,6 +1564,8 @@ byte *COM_LoadFile (char *path, int usehunk)
 		else
 			buf = loadbuf;
 	}
+	else if (usehunk == 5)
+		buf = Hunk_PlacedAlloc (len+1, base);
 	else
 		Sys_Error ("COM_LoadFile: bad usehunk");
 
@@ -1581,6 +1587,12 @@ byte *COM_LoadHunkFile (char *path)
 	return COM_LoadFile (path, 1);
 }
 
+// placed by the base name, which must be in the placement table
+byte *COM_LoadPlacedFile (char *path)
+{
+	return COM_LoadFile (path, 5);
+}
+
 byte *COM_LoadTempFile (char *path)
 {
 	return COM_LoadFile (path, 2);
@@ -1630,6 +1642,7 @@ pack_t *COM_LoadPackFile (char *packfile)
 //              Con_Printf ("Couldn't open %s\n", packfile);
 		return NULL;
 	}
+	Sys_FileReadAhead (packhandle, sizeof(header));
 	Sys_FileRead (packhandle, (void *)&header, sizeof(header));
 	if (header.id[0] != 'P' || header.id[1] != 'A'
 	|| header.id[2] != 'C' || header.id[3] != 'K')
@@ -1648,6 +1661,7 @@ pack_t *COM_LoadPackFile (char *packfile)
 	newfiles = Hunk_AllocName (numpackfiles * sizeof(packfile_t), "packfile");
 
 	Sys_FileSeek (packhandle, header.dirofs);
+	Sys_FileReadAhead (packhandle, header.dirlen);
 	Sys_FileRead (packhandle, (void *)info, header.dirlen);
 
 // crc the directory to check for modifications
@@ -154,6 +154,7 @@ void COM_InitArgv (int argc, char **argv);
 char *COM_SkipPath (char *pathname);
 void COM_StripExtension (char *in, char *out);
 void COM_FileBase (char *in, char *out, size_t outsize);
+char *COM_FileExtension (char *in);
 void COM_DefaultExtension (char *path, char *extension);
 
 char	*va(char *format, ...);
@@ -175,6 +176,7 @@ void COM_CloseFile (int h);
 byte *COM_LoadStackFile (char *path, void *buffer, int bufsize);
 byte *COM_LoadTempFile (char *path);
 byte *COM_LoadHunkFile (char *path);
+byte *COM_LoadPlacedFile (char *path);
 void COM_LoadCacheFile (char *path, struct cache_user_s *cu);
 
 
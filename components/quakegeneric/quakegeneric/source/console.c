@@ -43,9 +43,11 @@ int			con_totallines;		// total lines in console scrollback
 int			con_backscroll;		// lines up from bottom to display
 int			con_current;		// where next message will be printed
 int			con_x;				// offset in current line for next print
+int			con_changes;		// bumped whenever con_text changes
 char		*con_text=0;
 
 cvar_t		con_notifytime = {"con_notifytime","3"};		//seconds
+cvar_t		con_linecache = {"con_linecache","1"};
 
 #define	NUM_CON_TIMES 4
 float		con_times[NUM_CON_TIMES];	// realtime time the line was generated
@@ -103,6 +105,7 @@ void Con_Clear_f (void)
 {
 	if (con_text)
 		Q_memset (con_text, ' ', CON_TEXTSIZE);
+	con_changes++;
 }
 
 						
@@ -204,6 +207,7 @@ void Con_CheckResize (void)
 
 	con_backscroll = 0;
 	con_current = con_totallines - 1;
+	con_changes++;
 }
 
 
@@ -240,6 +244,7 @@ void Con_Init (void)
 // register our commands
 //
 	Cvar_RegisterVariable (&con_notifytime);
+	Cvar_RegisterVariable (&con_linecache);
 
 	Cmd_AddCommand ("toggleconsole", Con_ToggleConsole_f);
 	Cmd_AddCommand ("messagemode", Con_MessageMode_f);
@@ -279,6 +284,7 @@ void Con_Print (char *txt)
 	int		mask;
 	
 	con_backscroll = 0;
+	con_changes++;
 
 	if (txt[0] == 1)
 	{
@@ -473,6 +479,132 @@ DRAWING
 */
 
 
+/*
+==============================================================================
+
+LINE CACHE
+
+The console is drawn as strips of its background, most with a line of text
+on them.  Each strip is also kept as drawn in con_stripcache, at its place on
+the screen, along with what went into it, and strips that would come out the
+same are copied back instead of drawn.  Until the text scrolls, that is all
+of them but the input line.
+
+==============================================================================
+*/
+
+#define	CON_TOPSTRIP	0		// background above the text
+#define	CON_INPUTSTRIP	1
+#define	CON_BOTTOMSTRIP	2
+#define	CON_TEXTSTRIPS	3		// first line of the scrollback
+
+typedef struct
+{
+	int		lines;		// console height it was drawn for, 0 if never
+	int		y, height;
+	int		textlen;
+	char	text[MAXCMDLINE];
+} constrip_t;
+
+static constrip_t	*con_strips;
+static int			con_numstrips;
+static byte			*con_stripcache;
+static int			con_stripwidth, con_stripheight;
+
+/*
+================
+Con_CheckStrips
+
+(Re)allocates the line cache to fit the console, or frees it if disabled
+================
+*/
+static void Con_CheckStrips (void)
+{
+	if (con_stripcache && con_linecache.value
+	&& con_stripwidth == vid.conwidth && con_stripheight == vid.conheight)
+		return;
+
+	free (con_stripcache);
+	free (con_strips);
+	con_stripcache = NULL;
+	con_strips = NULL;
+	con_numstrips = 0;
+
+	if (!con_linecache.value)
+		return;
+
+	con_stripwidth = vid.conwidth;
+	con_stripheight = vid.conheight;
+	con_numstrips = CON_TEXTSTRIPS + (con_stripheight >> 3) + 1;
+	con_stripcache = malloc (con_stripwidth * con_stripheight);
+	con_strips = calloc (con_numstrips, sizeof(constrip_t));
+
+	if (!con_stripcache || !con_strips)
+	{
+		free (con_stripcache);
+		free (con_strips);
+		con_stripcache = NULL;
+		con_strips = NULL;
+		con_numstrips = 0;
+	}
+}
+
+/*
+================
+Con_DrawStrip
+
+Background rows y to y+height-1 of a console lines tall, with count
+characters of text along the top of them
+================
+*/
+static void Con_DrawStrip (int slot, int lines, int y, int height, char *text,
+	int count)
+{
+	constrip_t	*st;
+	byte		*src, *dest;
+	int			y0, y1, v;
+
+	y0 = y < 0 ? 0 : y;
+	y1 = y + height > lines ? lines : y + height;
+	if (y1 <= y0)
+		return;
+
+	if (count > MAXCMDLINE)
+		count = MAXCMDLINE;
+
+	st = slot < con_numstrips ? &con_strips[slot] : NULL;
+
+	if (st && st->lines == lines && st->y == y && st->height == height
+	&& st->textlen == count && (!count || !memcmp (st->text, text, count)))
+	{
+		src = con_stripcache + y0*con_stripwidth;
+		dest = vid.conbuffer + y0*vid.conrowbytes;
+		for (v=y0 ; v<y1 ; v++, src += con_stripwidth, dest += vid.conrowbytes)
+			memcpy (dest, src, con_stripwidth);
+		return;
+	}
+
+	Draw_ConsoleBackgroundRows (lines, y0, y1);
+	if (count)
+		Draw_Text (8, y, text, count, 0);
+
+	if (!st)
+		return;
+
+	src = vid.conbuffer + y0*vid.conrowbytes;
+	dest = con_stripcache + y0*con_stripwidth;
+	for (v=y0 ; v<y1 ; v++, src += vid.conrowbytes, dest += con_stripwidth)
+		memcpy (dest, src, con_stripwidth);
+
+	st->lines = lines;
+	st->y = y;
+	st->height = height;
+	st->textlen = count;
+	if (count)
+		memcpy (st->text, text, count);
+}
+
+
 /*
 ================
 Con_DrawInput
@@ -482,12 +614,15 @@ The input line scrolls horizontally if typing goes beyond the right edge
 */
 void Con_DrawInput (void)
 {
-	int		y;
 	int		i;
 	char	*text;
 
 	if (key_dest != key_console && !con_forcedup)
-		return;		// don't draw anything
+	{	// don't draw anything
+		Con_DrawStrip (CON_INPUTSTRIP, con_vislines, con_vislines-16, 8,
+				NULL, 0);
+		return;
+	}
 
 	text = key_lines[edit_line];
 	
@@ -503,10 +638,8 @@ void Con_DrawInput (void)
 		text += 1 + key_linepos - con_linewidth;
 		
 // draw it
-	y = con_vislines-16;
-
-	for (i=0 ; i<con_linewidth ; i++)
-		Draw_Character ( (i+1)<<3, con_vislines - 16, text[i]);
+	Con_DrawStrip (CON_INPUTSTRIP, con_vislines, con_vislines-16, 8,
+			text, con_linewidth);
 
 // remove cursor
 	key_lines[edit_line][key_linepos] = 0;
@@ -544,8 +677,7 @@ void Con_DrawNotify (void)
 		clearnotify = 0;
 		scr_copytop = 1;
 
-		for (x = 0 ; x < con_linewidth ; x++)
-			Draw_Character ( (x+1)<<3, v, text[x]);
+		Draw_Text (8, v, text, con_linewidth, 0);
 
 		v += 8;
 	}
@@ -556,14 +688,10 @@ void Con_DrawNotify (void)
 		clearnotify = 0;
 		scr_copytop = 1;
 	
-		x = 0;
+		x = strlen (chat_buffer);
 		
 		Draw_String (8, v, "say:");
-		while(chat_buffer[x])
-		{
-			Draw_Character ( (x+5)<<3, v, chat_buffer[x]);
-			x++;
-		}
+		Draw_Text (40, v, chat_buffer, x, 0);
 		Draw_Character ( (x+5)<<3, v, 10+((int)(realtime*con_cursorspeed)&1));
 		v += 8;
 	}
@@ -582,16 +710,15 @@ The typing input line at the bottom should only be drawn if typing is allowed
 */
 void Con_DrawConsole (int lines, qboolean drawinput)
 {
-	int				i, x, y;
+	int				i, y;
 	int				rows;
 	char			*text;
-	int				j;
+	int				j, k;
 	
 	if (lines <= 0)
 		return;
 
-// draw the background
-	Draw_ConsoleBackground (lines);
+	Con_CheckStrips ();
 
 // draw the text
 	con_vislines = lines;
@@ -599,20 +726,56 @@ void Con_DrawConsole (int lines, qboolean drawinput)
 	rows = (lines-16)>>3;		// rows of text to draw
 	y = lines - 16 - (rows<<3);	// may start slightly negative
 
-	for (i= con_current - rows + 1 ; i<=con_current ; i++, y+=8 )
+	Con_DrawStrip (CON_TOPSTRIP, lines, 0, y, NULL, 0);
+
+	for (i= con_current - rows + 1, k=0 ; i<=con_current ; i++, k++, y+=8 )
 	{
 		j = i - con_backscroll;
 		if (j<0)
 			j = 0;
 		text = con_text + (j % con_totallines)*con_linewidth;
 
-		for (x=0 ; x<con_linewidth ; x++)
-			Draw_Character ( (x+1)<<3, y, text[x]);
+		Con_DrawStrip (CON_TEXTSTRIPS + k, lines, y, 8, text, con_linewidth);
 	}
 
 // draw the input prompt, user text, and cursor if desired
 	if (drawinput)
 		Con_DrawInput ();
+	else
+		Con_DrawStrip (CON_INPUTSTRIP, lines, lines-16, 8, NULL, 0);
+
+	Con_DrawStrip (CON_BOTTOMSTRIP, lines, lines-8, 8, NULL, 0);
+}
+
+
+/*
+================
+Con_DrawKey
+
+Returns a value that only changes when Con_DrawConsole (lines, true) may draw
+something different
+================
+*/
+int Con_DrawKey (int lines)
+{
+	int		i, key;
+	char	*text;
+
+	key = con_changes;
+	key = key * 31 + con_backscroll;
+	key = key * 31 + lines;
+
+	if (key_dest == key_console || con_forcedup)
+	{
+		key = key * 31 + ((int)(realtime*con_cursorspeed)&1);
+		key = key * 31 + key_linepos;
+
+		text = key_lines[edit_line];
+		for (i=0 ; i<key_linepos ; i++)
+			key = key * 31 + text[i];
+	}
+
+	return key;
 }
 
 
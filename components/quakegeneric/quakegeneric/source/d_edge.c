@@ -80,14 +80,14 @@ D_DrawSolidSurface
 
 // FIXME: clean this up
 
-void D_DrawSolidSurface (surf_t *surf, int color)
+void D_DrawSolidSurface (espan_t *spans, int color)
 {
 	espan_t	*span;
 	byte	*pdest;
 	int		u, u2, pix;
 	
 	pix = (color<<24) | (color<<16) | (color<<8) | color;
-	for (span=surf->spans ; span ; span=span->pnext)
+	for (span=spans ; span ; span=span->pnext)
 	{
 		pdest = (byte *)d_viewbuffer + screenwidth*span->v;
 		u = span->u;
@@ -166,6 +166,39 @@ void D_CalcGradients (msurface_t *pface)
 }
 
 
+/*
+==============
+D_SurfaceSpans
+
+Returns the spans of s to draw now. When drawing a band, only the spans in
+it are detached; spans are added to the head of a surface's list as the scan
+moves down the screen, so the lowest rows are always first and the bands
+are drawn bottom to top
+==============
+*/
+static espan_t *D_SurfaceSpans (surf_t *s)
+{
+	espan_t	*spans, *last;
+
+	spans = s->spans;
+
+	if (!d_tiling || !spans)
+		return spans;
+
+	if (spans->v < d_tiley0)
+		return NULL;
+
+	for (last = spans ; last->pnext && last->pnext->v >= d_tiley0 ;
+		 last = last->pnext)
+		;
+
+	s->spans = last->pnext;
+	last->pnext = NULL;
+
+	return spans;
+}
+
+
 /*
 ==============
 D_DrawSurfaces
@@ -174,6 +207,7 @@ D_DrawSurfaces
 void D_DrawSurfaces (void)
 {
 	surf_t			*s;
+	espan_t			*spans;
 	msurface_t		*pface;
 	surfcache_t		*pcurrentcache;
 	vec3_t			world_transformed_modelorg;
@@ -188,24 +222,30 @@ void D_DrawSurfaces (void)
 	{
 		for (s = &surfaces[1] ; s<surface_p ; s++)
 		{
-			if (!s->spans)
+			if (!(spans = D_SurfaceSpans (s)))
 				continue;
 
+			if (d_tilestats.value)
+				D_CountSpanWrites (spans);
+
 			d_zistepu = s->d_zistepu;
 			d_zistepv = s->d_zistepv;
 			d_ziorigin = s->d_ziorigin;
 
-			D_DrawSolidSurface (s, (intptr_t)s->data & 0xFF);
-			D_DrawZSpans (s->spans);
+			D_DrawSolidSurface (spans, (intptr_t)s->data & 0xFF);
+			D_DrawZSpans (spans);
 		}
 	}
 	else
 	{
 		for (s = &surfaces[1] ; s<surface_p ; s++)
 		{
-			if (!s->spans)
+			if (!(spans = D_SurfaceSpans (s)))
 				continue;
 
+			if (d_tilestats.value)
+				D_CountSpanWrites (spans);
+
 			r_drawnpolycount++;
 
 			d_zistepu = s->d_zistepu;
@@ -214,13 +254,8 @@ void D_DrawSurfaces (void)
 
 			if (s->flags & SURF_DRAWSKY)
 			{
-				if (!r_skymade)
-				{
-					R_MakeSky ();
-				}
-
-				D_DrawSkyScans8 (s->spans);
-				D_DrawZSpans (s->spans);
+				D_DrawSkyScans8 (spans);
+				D_DrawZSpans (spans);
 			}
 			else if (s->flags & SURF_DRAWBACKGROUND)
 			{
@@ -230,8 +265,8 @@ void D_DrawSurfaces (void)
 				d_zistepv = 0;
 				d_ziorigin = -0.9;
 
-				D_DrawSolidSurface (s, (int)r_clearcolor.value & 0xFF);
-				D_DrawZSpans (s->spans);
+				D_DrawSolidSurface (spans, (int)r_clearcolor.value & 0xFF);
+				D_DrawZSpans (spans);
 			}
 			else if (s->flags & SURF_DRAWTURB)
 			{
@@ -257,8 +292,8 @@ void D_DrawSurfaces (void)
 				}
 
 				D_CalcGradients (pface);
-				Turbulent8 (s->spans);
-				D_DrawZSpans (s->spans);
+				Turbulent8 (spans);
+				D_DrawZSpans (spans);
 
 				if (s->insubmodel)
 				{
@@ -304,9 +339,9 @@ void D_DrawSurfaces (void)
 
 				D_CalcGradients (pface);
 
-				(*d_drawspans) (s->spans);
+				(*d_drawspans) (spans);
 
-				D_DrawZSpans (s->spans);
+				D_DrawZSpans (spans);
 
 				if (s->insubmodel)
 				{
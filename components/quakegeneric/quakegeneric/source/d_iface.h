@@ -21,6 +21,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakegeneric.h"
 
+// build the span and z span drawers without float math per span or per pixel
+// (see d_scan.c), to measure what the FPU costs; off by default
+//#define R_FIXEDPOINT
+
 #define WARP_WIDTH		QUAKEGENERIC_RES_X
 #define WARP_HEIGHT		QUAKEGENERIC_RES_Y
 
@@ -99,6 +103,8 @@ typedef struct
 	mspriteframe_t	*pspriteframe;
 	vec3_t			vup, vright, vpn;	// in worldspace
 	float			nearzi;
+	float			rectleft, recttop;		// unclipped screen rectangle for
+	float			rectright, rectbottom;	//  D_DrawSpriteRect
 } spritedesc_t;
 
 typedef struct
@@ -150,9 +156,14 @@ void D_DisableBackBufferAccess (void);
 void D_EndDirectRect (int x, int y, int width, int height);
 void D_PolysetDraw (void);
 void D_PolysetDrawFinalVerts (finalvert_t *fv, int numverts);
-void D_DrawParticle (particle_t *pparticle);
+void D_InitParticles (int maxparticles);
+void D_ProjectParticles (int count, float **org, float *die, float time,
+	byte *color);
+void D_MarkParticleZNeeds (void);
+void D_DrawParticles (void);
 void D_DrawPoly (void);
 void D_DrawSprite (void);
+void D_DrawSpriteRect (void);
 void D_DrawSurfaces (void);
 void D_DrawZPoint (void);
 void D_EnableBackBufferAccess (void);
@@ -163,6 +174,25 @@ void D_SetupFrame (void);
 void D_StartParticles (void);
 void D_TurnZOn (void);
 void D_WarpScreen (void);
+extern qboolean	d_zneedall;	// set by D_ClearZNeeds if every span writes z
+extern int		d_spanshidden;	// alias spans rejected by coarse z
+extern int		d_numparticles;	// visible after D_ProjectParticles
+extern int		d_zpixcount, d_zpixskipped;
+void D_ClearZNeeds (void);
+
+// banded rendering into an internal RAM scratch target, see d_tile.c
+extern cvar_t	d_tiled;
+extern cvar_t	d_tilestats;
+extern qboolean	d_tiling;			// a band is being drawn this frame
+extern int		d_tiley0, d_tiley1;	// screen rows of the current band
+qboolean D_BeginTiles (void);
+void D_SetTile (int y0, int y1);
+void D_FlushTile (void);
+void D_EndTiles (void);
+void D_PrintTileStats (void);
+
+#define D_TILE_HEIGHT	32		// rows per band
+void D_MarkZNeed (int x0, int y0, int x1, int y1);
 
 void D_FillRect (vrect_t *vrect, int color);
 void D_DrawRect (void);
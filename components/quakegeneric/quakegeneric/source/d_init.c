@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 cvar_t	d_subdiv16 = {"d_subdiv16", "1"};
 cvar_t	d_mipcap = {"d_mipcap", "0"};
 cvar_t	d_mipscale = {"d_mipscale", "1"};
+cvar_t	d_zmask = {"d_zmask", "1"};
 
 surfcache_t		*d_initial_rover;
 qboolean		d_roverwrapped;
@@ -53,11 +54,22 @@ void D_Init (void)
 	Cvar_RegisterVariable (&d_subdiv16);
 	Cvar_RegisterVariable (&d_mipcap);
 	Cvar_RegisterVariable (&d_mipscale);
+	Cvar_RegisterVariable (&d_zmask);
+	Cvar_RegisterVariable (&d_coarsez);
+	Cvar_RegisterVariable (&d_tiled);
+	Cvar_RegisterVariable (&d_tilestats);
+
+	d_scantable = Hunk_PlacedAlloc (MAXHEIGHT * sizeof(int), "scantab");
+	zspantable = Hunk_PlacedAlloc (MAXHEIGHT * sizeof(short *), "zspantab");
 
 	r_drawpolys = false;
 	r_worldpolysbacktofront = false;
 	r_recursiveaffinetriangles = true;
 	r_aliasuvscale = 1.0;
+
+#ifdef R_FIXEDPOINT
+	Con_Printf ("Fixed-point spans\n");
+#endif
 }
 
 
@@ -146,6 +158,8 @@ void D_SetupFrame (void)
 				d_drawspans = D_DrawSpans8;
 
 	d_aflatcolor = 0;
+
+	D_SetFullScissor ();
 }
 
 
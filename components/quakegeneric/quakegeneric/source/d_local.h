@@ -55,6 +55,24 @@ typedef struct sspan_s
 } sspan_t;
 
 extern cvar_t	d_subdiv16;
+extern cvar_t	d_zmask;
+extern cvar_t	d_coarsez;
+
+// the z buffer is only read by alias models, sprites and particles, so world
+// spans only write z in the screen tiles those have been marked in
+#define D_ZTILE_SHIFT	4
+#define D_ZTILE_SIZE	(1 << D_ZTILE_SHIFT)
+#define D_ZTILES_X		((MAXWIDTH + D_ZTILE_SIZE - 1) >> D_ZTILE_SHIFT)
+#define D_ZTILES_Y		((MAXHEIGHT + D_ZTILE_SIZE - 1) >> D_ZTILE_SHIFT)
+
+extern byte		d_zneed[D_ZTILES_Y][D_ZTILES_X];
+
+extern short	*d_pzscissor0, *d_pzscissor1;	// z rows inside the band
+extern int		d_tilewritebytes, d_framewritebytes;
+
+void D_SetFullScissor (void);
+void D_InvalidateCoarseZ (void);
+void D_CountSpanWrites (espan_t *pspan);
 
 extern float	scale_for_mip;
 
@@ -74,6 +92,7 @@ void D_DrawSpans8 (espan_t *pspans);
 void D_DrawSpans16 (espan_t *pspans);
 void D_DrawZSpans (espan_t *pspans);
 void Turbulent8 (espan_t *pspan);
+void D_BuildWarpTables (void);
 void D_SpriteDrawSpans (sspan_t *pspan);
 
 void D_DrawSkyScans8 (espan_t *pspan);
@@ -88,7 +107,7 @@ extern short *d_pzbuffer;
 extern unsigned int d_zrowbytes, d_zwidth;
 
 extern int	*d_pscantable;
-extern int	d_scantable[MAXHEIGHT];
+extern int	*d_scantable;
 
 extern int	d_vrectx, d_vrecty, d_vrectright_particle, d_vrectbottom_particle;
 
@@ -96,7 +115,7 @@ extern int	d_y_aspect_shift, d_pix_min, d_pix_max, d_pix_shift;
 
 extern pixel_t	*d_viewbuffer;
 
-extern short	*zspantable[MAXHEIGHT];
+extern short	**zspantable;
 
 extern int		d_minmip;
 extern float	d_scalemip[3];
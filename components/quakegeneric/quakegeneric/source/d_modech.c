@@ -21,15 +21,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "d_local.h"
-#include "esp_attr.h"
 
 
 int	d_vrectx, d_vrecty, d_vrectright_particle, d_vrectbottom_particle;
 
 int	d_y_aspect_shift, d_pix_min, d_pix_max, d_pix_shift;
 
-EXT_RAM_BSS_ATTR int		d_scantable[MAXHEIGHT];
-EXT_RAM_BSS_ATTR short	*zspantable[MAXHEIGHT]; 
+int		*d_scantable;		// MAXHEIGHT, placed by D_Init
+short	**zspantable;
 
 /*
 ================
@@ -81,5 +80,8 @@ void D_ViewChanged (void)
 			zspantable[i] = d_pzbuffer + i*d_zwidth;
 		}
 	}
+
+	if (r_dowarp)
+		D_BuildWarpTables ();
 }
 
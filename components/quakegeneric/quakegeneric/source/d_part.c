@@ -44,158 +44,250 @@ void D_StartParticles (void)
 // not used by software driver
 }
 
+/*
+==============================================================================
+
+BATCHED PARTICLES
+
+All the live particles are projected and culled in one pass, then bucketed
+by their top screen row, so each band (or the whole view) draws its squares
+in row order with a single walk of the list.
+
+==============================================================================
+*/
+
+typedef struct
+{
+	short	u, v;
+	int		izi;
+	byte	color, pix;
+} dparticle_t;
+
+static dparticle_t	*d_particles;
+static int			*d_particleorder;		// d_particles indices by row
+static int			d_particlerows[MAXHEIGHT + 1];	// first in order per row
+static int			d_maxparticles;
+
+int		d_numparticles;		// visible after the last D_ProjectParticles
+
 /*
 ==============
-D_DrawParticle
+D_InitParticles
 ==============
 */
-void D_DrawParticle (particle_t *pparticle)
+void D_InitParticles (int maxparticles)
 {
-	vec3_t	local, transformed;
-	float	zi;
-	byte	*pdest;
-	short	*pz;
-	int		i, izi, pix, count, u, v;
+	d_maxparticles = maxparticles;
+	d_particles = Hunk_AllocName (maxparticles * sizeof(dparticle_t),
+			"dparts");
+	d_particleorder = Hunk_AllocName (maxparticles * sizeof(int), "dparts");
+}
 
-// transform point
-	VectorSubtract (pparticle->org, r_origin, local);
 
-	transformed[0] = DotProduct(local, r_pright);
-	transformed[1] = DotProduct(local, r_pup);
-	transformed[2] = DotProduct(local, r_ppn);		
+/*
+==============
+D_ProjectParticles
 
-	if (transformed[2] < PARTICLE_Z_CLIP)
-		return;
+Particles whose die time is before time are skipped
+==============
+*/
+void D_ProjectParticles (int count, float **org, float *die, float time,
+	byte *color)
+{
+	int			i, n, u, v, izi, pix;
+	float		x, y, z, zi;
+	dparticle_t	*pd;
+
+	if (count > d_maxparticles)
+		count = d_maxparticles;
 
-// project the point
-// FIXME: preadjust xcenter and ycenter
-	zi = 1.0 / transformed[2];
-	u = (int)(xcenter + zi * transformed[0] + 0.5);
-	v = (int)(ycenter - zi * transformed[1] + 0.5);
+	memset (d_particlerows, 0, (vid.height + 1) * sizeof(d_particlerows[0]));
 
-	if ((v > d_vrectbottom_particle) || 
-		(u > d_vrectright_particle) ||
-		(v < d_vrecty) ||
-		(u < d_vrectx))
+	n = 0;
+	pd = d_particles;
+
+	for (i=0 ; i<count ; i++)
 	{
-		return;
+		if (die[i] < time)
+			continue;
+
+		x = org[0][i] - r_origin[0];
+		y = org[1][i] - r_origin[1];
+		z = org[2][i] - r_origin[2];
+
+		zi = x * r_ppn[0] + y * r_ppn[1] + z * r_ppn[2];
+		if (zi < PARTICLE_Z_CLIP)
+			continue;
+
+	// FIXME: preadjust xcenter and ycenter
+		zi = 1.0 / zi;
+		u = (int)(xcenter + zi * (x * r_pright[0] + y * r_pright[1] +
+				z * r_pright[2]) + 0.5);
+		v = (int)(ycenter - zi * (x * r_pup[0] + y * r_pup[1] +
+				z * r_pup[2]) + 0.5);
+
+		if ((v > d_vrectbottom_particle) ||
+			(u > d_vrectright_particle) ||
+			(v < d_vrecty) ||
+			(u < d_vrectx))
+		{
+			continue;
+		}
+
+		izi = (int)(zi * 0x8000);
+
+		pix = izi >> d_pix_shift;
+
+		if (pix < d_pix_min)
+			pix = d_pix_min;
+		else if (pix > d_pix_max)
+			pix = d_pix_max;
+
+		pd->u = u;
+		pd->v = v;
+		pd->izi = izi;
+		pd->color = color[i];
+		pd->pix = pix;
+		pd++;
+		n++;
+
+		d_particlerows[v + 1]++;
 	}
 
-	pz = d_pzbuffer + (d_zwidth * v) + u;
-	pdest = d_viewbuffer + d_scantable[v] + u;
-	izi = (int)(zi * 0x8000);
+// turn the row counts into starting places and sort into them
+	for (v=1 ; v<=vid.height ; v++)
+		d_particlerows[v] += d_particlerows[v - 1];
 
-	pix = izi >> d_pix_shift;
+	for (i=0, pd=d_particles ; i<n ; i++, pd++)
+		d_particleorder[d_particlerows[pd->v]++] = i;
 
-	if (pix < d_pix_min)
-		pix = d_pix_min;
-	else if (pix > d_pix_max)
-		pix = d_pix_max;
+// the scatter left each row's count pointing at the next row's start
+	for (v=vid.height ; v>0 ; v--)
+		d_particlerows[v] = d_particlerows[v - 1];
+	d_particlerows[0] = 0;
+
+	d_numparticles = n;
+}
+
+
+/*
+==============
+D_MarkParticleZNeeds
+==============
+*/
+void D_MarkParticleZNeeds (void)
+{
+	int			i;
+	dparticle_t	*pd;
 
-	switch (pix)
+	for (i=0, pd=d_particles ; i<d_numparticles ; i++, pd++)
 	{
-	case 1:
-		count = 1 << d_y_aspect_shift;
+		D_MarkZNeed (pd->u, pd->v, pd->u + pd->pix - 1,
+				pd->v + (pd->pix << d_y_aspect_shift) - 1);
+	}
+}
 
-		for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
-		{
-			if (pz[0] <= izi)
-			{
-				pz[0] = izi;
-				pdest[0] = pparticle->color;
-			}
-		}
-		break;
 
-	case 2:
-		count = 2 << d_y_aspect_shift;
+#define PARTICLE_PIXEL(i)		\
+	if (pz[i] <= izi)			\
+	{							\
+		pz[i] = izi;			\
+		pdest[i] = color;		\
+	}
 
-		for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
-		{
-			if (pz[0] <= izi)
-			{
-				pz[0] = izi;
-				pdest[0] = pparticle->color;
-			}
+/*
+==============
+D_DrawParticles
 
-			if (pz[1] <= izi)
-			{
-				pz[1] = izi;
-				pdest[1] = pparticle->color;
-			}
-		}
-		break;
+Draws the projected particles that reach into the current band
+==============
+*/
+void D_DrawParticles (void)
+{
+	int			i, j, first, last, v, count, pix, izi;
+	byte		color;
+	byte		*pdest;
+	short		*pz;
+	dparticle_t	*pd;
 
-	case 3:
-		count = 3 << d_y_aspect_shift;
+	if (!d_numparticles)
+		return;
 
-		for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
-		{
-			if (pz[0] <= izi)
-			{
-				pz[0] = izi;
-				pdest[0] = pparticle->color;
-			}
+// a particle can start this many rows above the band and still reach it
+	v = d_tiley0 - (d_pix_max << d_y_aspect_shift) + 1;
+	if (v < 0)
+		v = 0;
+	first = d_particlerows[v];
+	last = d_particlerows[d_tiley1 < vid.height ? d_tiley1 : vid.height];
 
-			if (pz[1] <= izi)
-			{
-				pz[1] = izi;
-				pdest[1] = pparticle->color;
-			}
+	for (i=first ; i<last ; i++)
+	{
+		pd = &d_particles[d_particleorder[i]];
 
-			if (pz[2] <= izi)
-			{
-				pz[2] = izi;
-				pdest[2] = pparticle->color;
-			}
+		pix = pd->pix;
+		v = pd->v;
+		count = pix << d_y_aspect_shift;
+
+		if (v + count > d_tiley1)
+			count = d_tiley1 - v;
+		if (v < d_tiley0)
+		{
+			count -= d_tiley0 - v;
+			v = d_tiley0;
 		}
-		break;
+		if (count <= 0)
+			continue;
 
-	case 4:
-		count = 4 << d_y_aspect_shift;
+		izi = pd->izi;
+		color = pd->color;
+		pz = d_pzbuffer + (d_zwidth * v) + pd->u;
+		pdest = d_viewbuffer + d_scantable[v] + pd->u;
 
-		for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
+		switch (pix)
 		{
-			if (pz[0] <= izi)
+		case 1:
+			for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
 			{
-				pz[0] = izi;
-				pdest[0] = pparticle->color;
+				PARTICLE_PIXEL(0);
 			}
+			break;
 
-			if (pz[1] <= izi)
+		case 2:
+			for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
 			{
-				pz[1] = izi;
-				pdest[1] = pparticle->color;
+				PARTICLE_PIXEL(0);
+				PARTICLE_PIXEL(1);
 			}
+			break;
 
-			if (pz[2] <= izi)
+		case 3:
+			for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
 			{
-				pz[2] = izi;
-				pdest[2] = pparticle->color;
+				PARTICLE_PIXEL(0);
+				PARTICLE_PIXEL(1);
+				PARTICLE_PIXEL(2);
 			}
+			break;
 
-			if (pz[3] <= izi)
+		case 4:
+			for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
 			{
-				pz[3] = izi;
-				pdest[3] = pparticle->color;
+				PARTICLE_PIXEL(0);
+				PARTICLE_PIXEL(1);
+				PARTICLE_PIXEL(2);
+				PARTICLE_PIXEL(3);
 			}
-		}
-		break;
-
-	default:
-		count = pix << d_y_aspect_shift;
+			break;
 
-		for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
-		{
-			for (i=0 ; i<pix ; i++)
+		default:
+			for ( ; count ; count--, pz += d_zwidth, pdest += screenwidth)
 			{
-				if (pz[i] <= izi)
+				for (j=0 ; j<pix ; j++)
 				{
-					pz[i] = izi;
-					pdest[i] = pparticle->color;
+					PARTICLE_PIXEL(j);
 				}
 			}
+			break;
 		}
-		break;
 	}
 }
@@ -155,7 +155,8 @@ void D_PolysetDrawFinalVerts (finalvert_t *fv, int numverts)
 	// valid triangle coordinates for filling can include the bottom and
 	// right clip edges, due to the fill rule; these shouldn't be drawn
 		if ((fv->v[0] < r_refdef.vrectright) &&
-			(fv->v[1] < r_refdef.vrectbottom))
+			(fv->v[1] < r_refdef.vrectbottom) &&
+			(fv->v[1] >= d_tiley0) && (fv->v[1] < d_tiley1))
 		{
 			z = fv->v[5]>>16;
 			zbuf = zspantable[fv->v[1]] + fv->v[0];
@@ -365,7 +366,8 @@ split:
 		goto nodraw;
 	if ((lp2[1] == lp1[1]) && (lp2[0] < lp1[0]))
 		goto nodraw;
-
+	if ((new[1] < d_tiley0) || (new[1] >= d_tiley1))
+		goto nodraw;
 
 	z = new[5]>>16;
 	zbuf = zspantable[new[1]] + new[0];
@@ -581,20 +583,170 @@ void InitGel (byte *palette)
 }
 #endif
 
+/*
+==============================================================================
+
+COARSE Z
+
+Alias spans are tested against the lowest z of each screen tile they cross
+before any pixel is touched.  Everything drawn after the world only raises
+the z buffer, so a tile's minimum stays a safe bound for the rest of the
+frame or band once it has been taken.  Tiles are measured the first time a
+span asks for them.
+
+==============================================================================
+*/
+
+cvar_t	d_coarsez = {"d_coarsez", "1"};
+
+int		d_spanshidden;
+
+static short	d_coarsezmin[D_ZTILES_Y][D_ZTILES_X];
+static int		d_coarsezstamp[D_ZTILES_Y][D_ZTILES_X];
+static int		d_coarsezframe = 1;
+
+/*
+================
+D_InvalidateCoarseZ
+
+Called whenever the rasterizers are pointed at a different z target
+================
+*/
+void D_InvalidateCoarseZ (void)
+{
+	d_coarsezframe++;
+}
+
+/*
+================
+D_CoarseZ
+================
+*/
+static int D_CoarseZ (int tx, int ty)
+{
+	int		x0, x1, y0, y1, u, v, zmin;
+	short	*pz;
+
+	if (d_coarsezstamp[ty][tx] == d_coarsezframe)
+		return d_coarsezmin[ty][tx];
+
+	zmin = -0x8000;		// never rejects
+
+// z isn't kept up to date in tiles nothing asked for
+	if (d_zneedall || d_zneed[ty][tx])
+	{
+		x0 = tx << D_ZTILE_SHIFT;
+		x1 = x0 + D_ZTILE_SIZE;
+		if (x1 > (int)d_zwidth)
+			x1 = d_zwidth;
+		y0 = ty << D_ZTILE_SHIFT;
+		y1 = y0 + D_ZTILE_SIZE;
+		if (y0 < d_tiley0)
+			y0 = d_tiley0;
+		if (y1 > d_tiley1)
+			y1 = d_tiley1;
+
+		zmin = 0x7FFF;
+		for (v=y0 ; v<y1 ; v++)
+		{
+			pz = d_pzbuffer + v * d_zwidth;
+			for (u=x0 ; u<x1 ; u++)
+			{
+				if (pz[u] < zmin)
+					zmin = pz[u];
+			}
+		}
+	}
+
+	d_coarsezmin[ty][tx] = zmin;
+	d_coarsezstamp[ty][tx] = d_coarsezframe;
+
+	return zmin;
+}
+
+/*
+================
+D_PolysetSpanHidden
+
+True if every pixel of the span would fail its z test.  z is linear along
+the span, so only its larger end needs comparing.
+================
+*/
+static qboolean D_PolysetSpanHidden (short *pz, int count, int zi)
+{
+	int		offset, u, v, tx, lasttx, zmax;
+
+	zmax = zi + (count - 1) * r_zistepx;
+	if (zmax < zi)
+		zmax = zi;
+	zmax >>= 16;
+
+	offset = pz - d_pzbuffer;
+	v = offset / d_zwidth;
+	u = offset - v * d_zwidth;
+
+	lasttx = (u + count - 1) >> D_ZTILE_SHIFT;
+	v >>= D_ZTILE_SHIFT;
+
+	for (tx = u >> D_ZTILE_SHIFT ; tx <= lasttx ; tx++)
+	{
+		if (zmax >= D_CoarseZ (tx, v))
+			return false;
+	}
+
+	d_spanshidden++;
+	return true;
+}
+
+
 /*
 ================
 D_PolysetDrawSpans8
+
+The s and t fractions are kept in the high half of their words, so a step
+that carries out of the fraction wraps the word and the carry is just an
+unsigned compare.  Spans that the coarse z says are hidden are skipped.
 ================
 */
+
+#define SPAN_MINHIDDEN	8	// shorter spans aren't worth the tile lookups
+
+#define SPAN_PIXEL(i)										\
+	if ((lzi >> 16) >= lpz[i])								\
+	{														\
+		lpdest[i] = lcolormap[*lptex + (llight & 0xFF00)];	\
+		lpz[i] = lzi >> 16;									\
+	}														\
+	lzi += lzistep;											\
+	llight += llightstep;									\
+	lsfrac += lsstep;										\
+	lptex += lstwhole + (lsfrac < lsstep);					\
+	ltfrac += ltstep;										\
+	if (ltfrac < ltstep)									\
+		lptex += lskinwidth;
+
 void D_PolysetDrawSpans8 (spanpackage_t *pspanpackage)
 {
-	int		lcount;
-	byte	*lpdest;
-	byte	*lptex;
-	int		lsfrac, ltfrac;
-	int		llight;
-	int		lzi;
-	short	*lpz;
+	int				lcount;
+	byte			*lpdest;
+	byte			*lptex;
+	unsigned		lsfrac, ltfrac;
+	int				llight;
+	int				lzi;
+	short			*lpz;
+	byte			*lcolormap;
+	unsigned		lsstep, ltstep;
+	int				lzistep, llightstep, lstwhole, lskinwidth;
+	qboolean		coarsez;
+
+	lcolormap = (byte *)acolormap;
+	lsstep = (unsigned)a_sstepxfrac << 16;
+	ltstep = (unsigned)a_tstepxfrac << 16;
+	lzistep = r_zistepx;
+	llightstep = r_lstepx;
+	lstwhole = a_ststepxwhole;
+	lskinwidth = r_affinetridesc.skinwidth;
+	coarsez = d_coarsez.value != 0;
 
 	do
 	{
@@ -611,39 +763,42 @@ void D_PolysetDrawSpans8 (spanpackage_t *pspanpackage)
 			d_aspancount += ubasestep;
 		}
 
-		if (lcount)
+	// the error term still has to be stepped for rows outside the band
+		if (lcount && (pspanpackage->pz >= d_pzscissor0) &&
+			(pspanpackage->pz < d_pzscissor1))
 		{
+			lpz = pspanpackage->pz;
+			lzi = pspanpackage->zi;
+
+			if (coarsez && lcount >= SPAN_MINHIDDEN &&
+				D_PolysetSpanHidden (lpz, lcount, lzi))
+			{
+				pspanpackage++;
+				continue;
+			}
+
 			lpdest = pspanpackage->pdest;
 			lptex = pspanpackage->ptex;
-			lpz = pspanpackage->pz;
-			lsfrac = pspanpackage->sfrac;
-			ltfrac = pspanpackage->tfrac;
+			lsfrac = (unsigned)pspanpackage->sfrac << 16;
+			ltfrac = (unsigned)pspanpackage->tfrac << 16;
 			llight = pspanpackage->light;
-			lzi = pspanpackage->zi;
 
-			do
+			for ( ; lcount >= 4 ; lcount -= 4)
+			{
+				SPAN_PIXEL(0);
+				SPAN_PIXEL(1);
+				SPAN_PIXEL(2);
+				SPAN_PIXEL(3);
+				lpdest += 4;
+				lpz += 4;
+			}
+
+			for ( ; lcount ; lcount--)
 			{
-				if ((lzi >> 16) >= *lpz)
-				{
-					*lpdest = ((byte *)acolormap)[*lptex + (llight & 0xFF00)];
-// gel mapping					*lpdest = gelmap[*lpdest];
-					*lpz = lzi >> 16;
-				}
+				SPAN_PIXEL(0);
 				lpdest++;
-				lzi += r_zistepx;
 				lpz++;
-				llight += r_lstepx;
-				lptex += a_ststepxwhole;
-				lsfrac += a_sstepxfrac;
-				lptex += lsfrac >> 16;
-				lsfrac &= 0xFFFF;
-				ltfrac += a_tstepxfrac;
-				if (ltfrac & 0x10000)
-				{
-					lptex += r_affinetridesc.skinwidth;
-					ltfrac &= 0xFFFF;
-				}
-			} while (--lcount);
+			}
 		}
 
 		pspanpackage++;
@@ -673,7 +828,8 @@ void D_PolysetFillSpans8 (spanpackage_t *pspanpackage)
 		if (lcount == -1)
 			return;
 
-		if (lcount)
+		if (lcount && (pspanpackage->pz >= d_pzscissor0) &&
+			(pspanpackage->pz < d_pzscissor1))
 		{
 			lpdest = pspanpackage->pdest;
 
@@ -34,24 +34,39 @@ int				r_turb_spancount;
 void D_DrawTurbulent8Span (void);
 
 
+/*
+==============================================================================
+
+SCREEN WARP
+
+The mapping from screen to warp buffer rows and columns only depends on the
+view size, so it is worked out by D_ViewChanged.  The warp itself walks the
+screen a row at a time, copying the few warp buffer rows each screen row can
+reach into a small ring in internal RAM, so the warp buffer is read in order
+and the scattered reads stay out of external RAM.
+
+==============================================================================
+*/
+
+#define WARP_RING		8		// power of two, more than AMP2*2 rows
+
+static int	d_warprow[MAXHEIGHT+(AMP2*2)];		// warp buffer rows
+static int	d_warpcolumn[MAXWIDTH+(AMP2*2)];	// relative to vrect.x
+
+static byte	d_warpring[WARP_RING][WARP_WIDTH];
+
 /*
 =============
-D_WarpScreen
+D_BuildWarpTables
 
-// this performs a slight compression of the screen at the same time as
-// the sine warp, to keep the edges from wrapping
+this performs a slight compression of the screen at the same time as
+the sine warp, to keep the edges from wrapping
 =============
 */
-void D_WarpScreen (void)
+void D_BuildWarpTables (void)
 {
 	int		w, h;
 	int		u,v;
-	byte	*dest;
-	int		*turb;
-	int		*col;
-	byte	**row;
-	byte	*rowptr[MAXHEIGHT+(AMP2*2)];
-	int		column[MAXWIDTH+(AMP2*2)];
 	float	wratio, hratio;
 
 	w = r_refdef.vrect.width;
@@ -62,23 +77,54 @@ void D_WarpScreen (void)
 
 	for (v=0 ; v<scr_vrect.height+AMP2*2 ; v++)
 	{
-		rowptr[v] = d_viewbuffer + (r_refdef.vrect.y * screenwidth) +
-				 (screenwidth * (int)((float)v * hratio * h / (h + AMP2 * 2)));
+		d_warprow[v] = r_refdef.vrect.y +
+				(int)((float)v * hratio * h / (h + AMP2 * 2));
 	}
 
 	for (u=0 ; u<scr_vrect.width+AMP2*2 ; u++)
 	{
-		column[u] = r_refdef.vrect.x +
-				(int)((float)u * wratio * w / (w + AMP2 * 2));
+		d_warpcolumn[u] = (int)((float)u * wratio * w / (w + AMP2 * 2));
 	}
+}
+
+
+/*
+=============
+D_WarpRows
+
+Warps screen rows v0 to v1-1 through d_warpring, which is shared, so only
+one call may run at a time
+=============
+*/
+static void D_WarpRows (int v0, int v1, byte *turb)
+{
+	int		u, v, r, loaded;
+	byte	*dest, *src;
+	byte	*row[AMP2*2+1];
+	int		*col;
 
-	turb = intsintable + ((int)(cl.time*SPEED)&(CYCLE-1));
-	dest = vid.buffer + scr_vrect.y * vid.rowbytes + scr_vrect.x;
+	dest = vid.buffer + (scr_vrect.y + v0) * vid.rowbytes + scr_vrect.x;
+	src = d_viewbuffer + r_refdef.vrect.x;
+	loaded = -1;
 
-	for (v=0 ; v<scr_vrect.height ; v++, dest += vid.rowbytes)
+	for (v=v0 ; v<v1 ; v++, dest += vid.rowbytes)
 	{
-		col = &column[turb[v]];
-		row = &rowptr[v];
+	// bring in the rows this line can reach that aren't in the ring yet
+		r = d_warprow[v];
+		if (r <= loaded)
+			r = loaded + 1;
+
+		for ( ; r <= d_warprow[v + AMP2*2] ; r++)
+		{
+			memcpy (d_warpring[r & (WARP_RING-1)], src + r * WARP_WIDTH,
+					r_refdef.vrect.width);
+		}
+		loaded = r - 1;
+
+		for (u=0 ; u<=AMP2*2 ; u++)
+			row[u] = d_warpring[d_warprow[v + u] & (WARP_RING-1)];
+
+		col = &d_warpcolumn[turb[v]];
 
 		for (u=0 ; u<scr_vrect.width ; u+=4)
 		{
@@ -90,6 +136,37 @@ void D_WarpScreen (void)
 	}
 }
 
+
+/*
+=============
+D_WarpScreen
+=============
+*/
+void D_WarpScreen (void)
+{
+	D_WarpRows (0, scr_vrect.height,
+			intsintable + ((int)(cl.time*SPEED)&(CYCLE-1)));
+}
+
+
+/*
+==============================================================================
+
+TURBULENT SURFACES
+
+Turbulent8 reads its sine window and texture through copies in internal
+RAM, refreshed when the time or the texture changes.
+
+==============================================================================
+*/
+
+static int	d_turbtable[CYCLE];
+static int	d_turbphase = -1;
+
+static byte	d_turbtexture[64*64];
+static byte	*d_turbsource;
+static int	d_turbframe;
+
 /*
 =============
 D_DrawTurbulent8Span
@@ -97,16 +174,33 @@ D_DrawTurbulent8Span
 */
 void D_DrawTurbulent8Span (void)
 {
-	int		sturb, tturb;
+	int				sturb, tturb;
+	int				s, t, sstep, tstep, count;
+	int				*turb;
+	unsigned char	*pbase, *pdest;
+
+	s = r_turb_s;
+	t = r_turb_t;
+	sstep = r_turb_sstep;
+	tstep = r_turb_tstep;
+	turb = r_turb_turb;
+	pbase = r_turb_pbase;
+	pdest = r_turb_pdest;
+	count = r_turb_spancount;
 
 	do
 	{
-		sturb = ((r_turb_s + r_turb_turb[(r_turb_t>>16)&(CYCLE-1)])>>16)&63;
-		tturb = ((r_turb_t + r_turb_turb[(r_turb_s>>16)&(CYCLE-1)])>>16)&63;
-		*r_turb_pdest++ = *(r_turb_pbase + (tturb<<6) + sturb);
-		r_turb_s += r_turb_sstep;
-		r_turb_t += r_turb_tstep;
-	} while (--r_turb_spancount > 0);
+		sturb = ((s + turb[(t>>16)&(CYCLE-1)])>>16)&63;
+		tturb = ((t + turb[(s>>16)&(CYCLE-1)])>>16)&63;
+		*pdest++ = *(pbase + (tturb<<6) + sturb);
+		s += sstep;
+		t += tstep;
+	} while (--count > 0);
+
+	r_turb_s = s;
+	r_turb_t = t;
+	r_turb_pdest = pdest;
+	r_turb_spancount = count;
 }
 
 /*
@@ -116,17 +210,31 @@ Turbulent8
 */
 void Turbulent8 (espan_t *pspan)
 {
-	int				count;
+	int				count, phase;
 	fixed16_t		snext, tnext;
 	float			sdivz, tdivz, zi, z, du, dv, spancountminus1;
 	float			sdivz16stepu, tdivz16stepu, zi16stepu;
 	
-	r_turb_turb = sintable + ((int)(cl.time*SPEED)&(CYCLE-1));
+	phase = (int)(cl.time*SPEED)&(CYCLE-1);
+	if (phase != d_turbphase)
+	{
+		memcpy (d_turbtable, sintable + phase, sizeof(d_turbtable));
+		d_turbphase = phase;
+	}
+	r_turb_turb = d_turbtable;
 
 	r_turb_sstep = 0;	// keep compiler happy
 	r_turb_tstep = 0;	// ditto
 
-	r_turb_pbase = (unsigned char *)cacheblock;
+// the texture can move or be replaced between frames, so copy it again
+// each frame it is drawn in
+	if (((byte *)cacheblock != d_turbsource) || (r_framecount != d_turbframe))
+	{
+		memcpy (d_turbtexture, cacheblock, sizeof(d_turbtexture));
+		d_turbsource = (byte *)cacheblock;
+		d_turbframe = r_framecount;
+	}
+	r_turb_pbase = d_turbtexture;
 
 	sdivz16stepu = d_sdivzstepu * 16;
 	tdivz16stepu = d_tdivzstepu * 16;
@@ -241,6 +349,259 @@ void Turbulent8 (espan_t *pspan)
 	} while ((pspan = pspan->pnext) != NULL);
 }
 
+#ifdef R_FIXEDPOINT
+
+/*
+==============================================================================
+
+FIXED-POINT SPANS
+
+With R_FIXEDPOINT, the span and z span drawers take the surface's gradients
+once as 64-bit fixed point and do no float math per span or per pixel.  The
+divide for the 16.16 z at each 8 pixel step becomes a table lookup on the
+top bits of 1/z, refined by one Newton step.
+
+==============================================================================
+*/
+
+#define FX_ZISHIFT	40		// 1/z is scaled up by 2**40
+#define FX_STSHIFT	28		// s/z and t/z are scaled up by 2**28
+
+static const unsigned	rcptab[256] = {
+#include "rcptab.h"
+};
+
+static long long	d_fxsdivzorigin, d_fxsdivzstepu, d_fxsdivzstepv;
+static long long	d_fxtdivzorigin, d_fxtdivzstepu, d_fxtdivzstepv;
+static long long	d_fxziorigin, d_fxzistepu, d_fxzistepv;
+
+
+/*
+=============
+D_FixedGradients
+
+Takes the current surface's gradients into fixed point
+=============
+*/
+static void D_FixedGradients (void)
+{
+	d_fxsdivzorigin = (long long)(d_sdivzorigin * (double)(1 << FX_STSHIFT));
+	d_fxsdivzstepu = (long long)(d_sdivzstepu * (double)(1 << FX_STSHIFT));
+	d_fxsdivzstepv = (long long)(d_sdivzstepv * (double)(1 << FX_STSHIFT));
+	d_fxtdivzorigin = (long long)(d_tdivzorigin * (double)(1 << FX_STSHIFT));
+	d_fxtdivzstepu = (long long)(d_tdivzstepu * (double)(1 << FX_STSHIFT));
+	d_fxtdivzstepv = (long long)(d_tdivzstepv * (double)(1 << FX_STSHIFT));
+	d_fxziorigin = (long long)(d_ziorigin * (double)(1LL << FX_ZISHIFT));
+	d_fxzistepu = (long long)(d_zistepu * (double)(1LL << FX_ZISHIFT));
+	d_fxzistepv = (long long)(d_zistepv * (double)(1LL << FX_ZISHIFT));
+}
+
+
+/*
+=============
+D_FixedZ
+
+Returns 16.16 z for a 1/z scaled by 2**FX_ZISHIFT, saturating for anything
+too far away to matter
+=============
+*/
+static fixed16_t D_FixedZ (long long zi)
+{
+	unsigned long long	x;
+	unsigned			m;
+	long long			r, e;
+	int					k;
+
+	if (zi < (1LL << (FX_ZISHIFT + 16 - 31)))
+		return 0x7FFFFFFF;
+
+// k is the top set bit of 1/z, m is 1/z normalized to [2**31, 2**32)
+	x = zi;
+	k = 0;
+	if (x >> 32)
+	{
+		x >>= 32;
+		k += 32;
+	}
+	if (x >> 16)
+	{
+		x >>= 16;
+		k += 16;
+	}
+	if (x >> 8)
+	{
+		x >>= 8;
+		k += 8;
+	}
+	if (x >> 4)
+	{
+		x >>= 4;
+		k += 4;
+	}
+	if (x >> 2)
+	{
+		x >>= 2;
+		k += 2;
+	}
+	if (x >> 1)
+		k += 1;
+
+	if (k >= 31)
+		m = (unsigned)(zi >> (k - 31));
+	else
+		m = (unsigned)(zi << (31 - k));
+
+// r ~= 2**63 / m, good to about 9 bits from the table and 18 after one
+// Newton step
+	r = rcptab[(m >> 23) & 255];
+	e = (long long)((1ULL << 63) - (unsigned long long)m * (unsigned long long)r);
+	r += (r * (e >> 31)) >> 32;
+
+// 2**(FX_ZISHIFT+16) / (m * 2**(k-31))
+	r >>= k - (FX_ZISHIFT + 16 - 32);
+	if (r > 0x7FFFFFFF)
+		return 0x7FFFFFFF;
+
+	return (fixed16_t)r;
+}
+
+
+/*
+=============
+D_DrawSpans8
+=============
+*/
+void D_DrawSpans8 (espan_t *pspan)
+{
+	int				count, spancount, spancountminus1;
+	unsigned char	*pbase, *pdest;
+	fixed16_t		s, t, snext, tnext, sstep, tstep, z;
+	long long		sdivz, tdivz, zi;
+	long long		sdivz8stepu, tdivz8stepu, zi8stepu;
+
+	sstep = 0;	// keep compiler happy
+	tstep = 0;	// ditto
+
+	pbase = (unsigned char *)cacheblock;
+
+	D_FixedGradients ();
+
+	sdivz8stepu = d_fxsdivzstepu * 8;
+	tdivz8stepu = d_fxtdivzstepu * 8;
+	zi8stepu = d_fxzistepu * 8;
+
+	do
+	{
+		pdest = (unsigned char *)((byte *)d_viewbuffer +
+				(screenwidth * pspan->v) + pspan->u);
+
+		count = pspan->count;
+
+	// calculate the initial s/z, t/z, 1/z, s, and t and clamp
+		sdivz = d_fxsdivzorigin + pspan->v*d_fxsdivzstepv +
+				pspan->u*d_fxsdivzstepu;
+		tdivz = d_fxtdivzorigin + pspan->v*d_fxtdivzstepv +
+				pspan->u*d_fxtdivzstepu;
+		zi = d_fxziorigin + pspan->v*d_fxzistepv + pspan->u*d_fxzistepu;
+		z = D_FixedZ (zi);
+
+		s = (fixed16_t)((sdivz * z) >> FX_STSHIFT) + sadjust;
+		if (s > bbextents)
+			s = bbextents;
+		else if (s < 0)
+			s = 0;
+
+		t = (fixed16_t)((tdivz * z) >> FX_STSHIFT) + tadjust;
+		if (t > bbextentt)
+			t = bbextentt;
+		else if (t < 0)
+			t = 0;
+
+		do
+		{
+		// calculate s and t at the far end of the span
+			if (count >= 8)
+				spancount = 8;
+			else
+				spancount = count;
+
+			count -= spancount;
+
+			if (count)
+			{
+			// calculate s/z, t/z, zi->fixed s and t at far end of span,
+			// calculate s and t steps across span by shifting
+				sdivz += sdivz8stepu;
+				tdivz += tdivz8stepu;
+				zi += zi8stepu;
+				z = D_FixedZ (zi);
+
+				snext = (fixed16_t)((sdivz * z) >> FX_STSHIFT) + sadjust;
+				if (snext > bbextents)
+					snext = bbextents;
+				else if (snext < 8)
+					snext = 8;	// prevent round-off error on <0 steps from
+								//  from causing overstepping & running off the
+								//  edge of the texture
+
+				tnext = (fixed16_t)((tdivz * z) >> FX_STSHIFT) + tadjust;
+				if (tnext > bbextentt)
+					tnext = bbextentt;
+				else if (tnext < 8)
+					tnext = 8;	// guard against round-off error on <0 steps
+
+				sstep = (snext - s) >> 3;
+				tstep = (tnext - t) >> 3;
+			}
+			else
+			{
+			// calculate s/z, t/z, zi->fixed s and t at last pixel in span (so
+			// can't step off polygon), clamp, calculate s and t steps across
+			// span by division, biasing steps low so we don't run off the
+			// texture
+				spancountminus1 = spancount - 1;
+				sdivz += d_fxsdivzstepu * spancountminus1;
+				tdivz += d_fxtdivzstepu * spancountminus1;
+				zi += d_fxzistepu * spancountminus1;
+				z = D_FixedZ (zi);
+				snext = (fixed16_t)((sdivz * z) >> FX_STSHIFT) + sadjust;
+				if (snext > bbextents)
+					snext = bbextents;
+				else if (snext < 8)
+					snext = 8;	// prevent round-off error on <0 steps from
+								//  from causing overstepping & running off the
+								//  edge of the texture
+
+				tnext = (fixed16_t)((tdivz * z) >> FX_STSHIFT) + tadjust;
+				if (tnext > bbextentt)
+					tnext = bbextentt;
+				else if (tnext < 8)
+					tnext = 8;	// guard against round-off error on <0 steps
+
+				if (spancount > 1)
+				{
+					sstep = (snext - s) / (spancount - 1);
+					tstep = (tnext - t) / (spancount - 1);
+				}
+			}
+
+			do
+			{
+				*pdest++ = *(pbase + (s >> 16) + (t >> 16) * cachewidth);
+				s += sstep;
+				t += tstep;
+			} while (--spancount > 0);
+
+			s = snext;
+			t = tnext;
+
+		} while (count > 0);
+
+	} while ((pspan = pspan->pnext) != NULL);
+}
+
+#else	// !R_FIXEDPOINT
+
 /*
 =============
 D_DrawSpans8
@@ -374,6 +735,101 @@ void D_DrawSpans8 (espan_t *pspan)
 	} while ((pspan = pspan->pnext) != NULL);
 }
 
+#endif	// R_FIXEDPOINT
+
+/*
+=============
+D_ClearZNeeds
+=============
+*/
+qboolean	d_zneedall;
+byte		d_zneed[D_ZTILES_Y][D_ZTILES_X];
+int			d_zpixcount, d_zpixskipped;
+
+void D_ClearZNeeds (void)
+{
+	d_zpixcount = 0;
+	d_zpixskipped = 0;
+
+	d_zneedall = !d_zmask.value;
+	if (!d_zneedall)
+		memset (d_zneed, 0, sizeof(d_zneed));
+}
+
+
+/*
+=============
+D_MarkZNeed
+
+Flags the tiles touched by the inclusive pixel rectangle, so world spans
+write z there for the entities and particles that will test against it
+=============
+*/
+void D_MarkZNeed (int x0, int y0, int x1, int y1)
+{
+	int		x, y;
+
+	if (d_zneedall)
+		return;
+
+	if (x0 < r_refdef.vrect.x)
+		x0 = r_refdef.vrect.x;
+	if (y0 < r_refdef.vrect.y)
+		y0 = r_refdef.vrect.y;
+	if (x1 >= r_refdef.vrectright)
+		x1 = r_refdef.vrectright - 1;
+	if (y1 >= r_refdef.vrectbottom)
+		y1 = r_refdef.vrectbottom - 1;
+
+	if ((x0 > x1) || (y0 > y1))
+		return;
+
+	x0 >>= D_ZTILE_SHIFT;
+	x1 >>= D_ZTILE_SHIFT;
+	y0 >>= D_ZTILE_SHIFT;
+	y1 >>= D_ZTILE_SHIFT;
+
+	for (y=y0 ; y<=y1 ; y++)
+		for (x=x0 ; x<=x1 ; x++)
+			d_zneed[y][x] = 1;
+}
+
+
+/*
+=============
+D_DrawZSpan
+=============
+*/
+static void D_DrawZSpan (short *pdest, int count, int izi, int izistep)
+{
+	int				doublecount;
+	unsigned		ltemp;
+
+	if ((intptr_t)pdest & 0x02)
+	{
+		*pdest++ = (short)(izi >> 16);
+		izi += izistep;
+		count--;
+	}
+
+	if ((doublecount = count >> 1) > 0)
+	{
+		do
+		{
+			ltemp = izi >> 16;
+			izi += izistep;
+			ltemp |= izi & 0xFFFF0000;
+			izi += izistep;
+			*(int *)pdest = ltemp;
+			pdest += 2;
+		} while (--doublecount > 0);
+	}
+
+	if (count & 1)
+		*pdest = (short)(izi >> 16);
+}
+
+
 /*
 =============
 D_DrawZSpans
@@ -381,53 +837,81 @@ D_DrawZSpans
 */
 void D_DrawZSpans (espan_t *pspan)
 {
-	int				count, doublecount, izistep;
-	int				izi;
+	int				izistep, izi;
+	int				u, u2, tile, lasttile, runstart;
+	byte			*pneed;
 	short			*pdest;
-	unsigned		ltemp;
+#ifndef R_FIXEDPOINT
 	double			zi;
 	float			du, dv;
+#endif
 
+#ifdef R_FIXEDPOINT
+	D_FixedGradients ();
+	izistep = (int)(d_fxzistepu >> (FX_ZISHIFT - 31));
+#else
 // FIXME: check for clamping/range problems
 // we count on FP exceptions being turned off to avoid range problems
 	izistep = (int)(d_zistepu * 0x8000 * 0x10000);
+#endif
 
 	do
 	{
 		pdest = d_pzbuffer + (d_zwidth * pspan->v) + pspan->u;
 
-		count = pspan->count;
-
 	// calculate the initial 1/z
+#ifdef R_FIXEDPOINT
+		izi = (int)((d_fxziorigin + pspan->v*d_fxzistepv +
+				pspan->u*d_fxzistepu) >> (FX_ZISHIFT - 31));
+#else
 		du = (float)pspan->u;
 		dv = (float)pspan->v;
 
 		zi = d_ziorigin + dv*d_zistepv + du*d_zistepu;
 	// we count on FP exceptions being turned off to avoid range problems
 		izi = (int)(zi * 0x8000 * 0x10000);
+#endif
+
+		d_zpixcount += pspan->count;
 
-		if ((intptr_t)pdest & 0x02)
+		if (d_zneedall)
 		{
-			*pdest++ = (short)(izi >> 16);
-			izi += izistep;
-			count--;
+			D_DrawZSpan (pdest, pspan->count, izi, izistep);
+			continue;
 		}
 
-		if ((doublecount = count >> 1) > 0)
+	// only write the runs of tiles that something will z test against,
+	// stepping izi exactly as the whole span would have
+		pneed = d_zneed[pspan->v >> D_ZTILE_SHIFT];
+		u = pspan->u;
+		u2 = u + pspan->count;
+		lasttile = (u2 - 1) >> D_ZTILE_SHIFT;
+		runstart = -1;
+
+		for (tile = u >> D_ZTILE_SHIFT ; tile <= lasttile + 1 ; tile++)
 		{
-			do
+			if ((tile <= lasttile) && pneed[tile])
 			{
-				ltemp = izi >> 16;
-				izi += izistep;
-				ltemp |= izi & 0xFFFF0000;
-				izi += izistep;
-				*(int *)pdest = ltemp;
-				pdest += 2;
-			} while (--doublecount > 0);
+				if (runstart < 0)
+					runstart = (tile << D_ZTILE_SHIFT) > u ?
+							(tile << D_ZTILE_SHIFT) : u;
+				continue;
+			}
+
+			if (runstart >= 0)
+			{
+				int		runend;
+
+				runend = (tile << D_ZTILE_SHIFT) < u2 ?
+						(tile << D_ZTILE_SHIFT) : u2;
+				D_DrawZSpan (pdest + (runstart - u), runend - runstart,
+						izi + izistep * (runstart - u), izistep);
+				d_zpixskipped -= runend - runstart;
+				runstart = -1;
+			}
 		}
 
-		if (count & 1)
-			*pdest = (short)(izi >> 16);
+		d_zpixskipped += pspan->count;
 
 	} while ((pspan = pspan->pnext) != NULL);
 }
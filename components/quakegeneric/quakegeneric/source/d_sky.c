@@ -27,51 +27,138 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define SKY_SPAN_MAX	(1 << SKY_SPAN_SHIFT)
 
 
+static int		d_skyframe = -1;	// r_framecount the tables are for
+static int		d_skycolumns;
+static float	*d_skycolumn;		// wu*vright for each screen column
+static float	d_skyuscale, d_skyvscale;
+static float	d_skyrow[3];		// 4096*vpn + wv*vup for the current scan
+static float	d_skytemp;
+static fixed16_t	d_skyshift;		// front layer scroll past the back layer
+
+
 /*
 =================
-D_Sky_uv_To_st
+D_SkySetupFrame
+
+Works out what doesn't change across the frame's sky spans, including the
+horizontal part of the view ray for each column
 =================
 */
-void D_Sky_uv_To_st (int u, int v, fixed16_t *s, fixed16_t *t)
+static void D_SkySetupFrame (void)
 {
-	float	wu, wv, temp;
-	vec3_t	end;
+	int		u, columns;
+	float	temp, wu;
+
+	if (d_skyframe == r_framecount)
+		return;
+	d_skyframe = r_framecount;
 
 	if (r_refdef.vrect.width >= r_refdef.vrect.height)
 		temp = (float)r_refdef.vrect.width;
 	else
 		temp = (float)r_refdef.vrect.height;
 
-	wu = 8192.0 * (float)(u-((int)vid.width>>1)) / temp;
-	wv = 8192.0 * (float)(((int)vid.height>>1)-v) / temp;
+	d_skyuscale = 8192.0 / temp;
+	d_skyvscale = 8192.0 / temp;
+
+	d_skytemp = skytime*skyspeed;
+	d_skyshift = (int)d_skytemp << 16;
+
+	columns = screenwidth + 1;
+	if (columns > d_skycolumns)
+	{
+		free (d_skycolumn);
+		d_skycolumn = malloc (columns * 3 * sizeof(float));
+		d_skycolumns = d_skycolumn ? columns : 0;
+	}
+
+	if (!d_skycolumn)
+		return;
+
+	for (u=0 ; u<d_skycolumns ; u++)
+	{
+		wu = d_skyuscale * (float)(u-((int)vid.width>>1));
+		d_skycolumn[u*3+0] = wu*vright[0];
+		d_skycolumn[u*3+1] = wu*vright[1];
+		d_skycolumn[u*3+2] = wu*vright[2];
+	}
+}
+
+
+/*
+=================
+D_SkySetupRow
+=================
+*/
+static void D_SkySetupRow (int v)
+{
+	float	wv;
 
-	end[0] = 4096*vpn[0] + wu*vright[0] + wv*vup[0];
-	end[1] = 4096*vpn[1] + wu*vright[1] + wv*vup[1];
-	end[2] = 4096*vpn[2] + wu*vright[2] + wv*vup[2];
+	wv = d_skyvscale * (float)(((int)vid.height>>1)-v);
+
+	d_skyrow[0] = 4096*vpn[0] + wv*vup[0];
+	d_skyrow[1] = 4096*vpn[1] + wv*vup[1];
+	d_skyrow[2] = 4096*vpn[2] + wv*vup[2];
+}
+
+
+/*
+=================
+D_Sky_uv_To_st
+
+The scan's row must have been set up by D_SkySetupRow
+=================
+*/
+void D_Sky_uv_To_st (int u, int v, fixed16_t *s, fixed16_t *t)
+{
+	float	wu;
+	vec3_t	end;
+
+	if (u < d_skycolumns)
+	{
+		end[0] = d_skyrow[0] + d_skycolumn[u*3+0];
+		end[1] = d_skyrow[1] + d_skycolumn[u*3+1];
+		end[2] = d_skyrow[2] + d_skycolumn[u*3+2];
+	}
+	else
+	{
+		wu = d_skyuscale * (float)(u-((int)vid.width>>1));
+		end[0] = d_skyrow[0] + wu*vright[0];
+		end[1] = d_skyrow[1] + wu*vright[1];
+		end[2] = d_skyrow[2] + wu*vright[2];
+	}
 	end[2] *= 3;
 	VectorNormalize (end);
 
-	temp = skytime*skyspeed;	// TODO: add D_SetupFrame & set this there
-	*s = (int)((temp + 6*(SKYSIZE/2-1)*end[0]) * 0x10000);
-	*t = (int)((temp + 6*(SKYSIZE/2-1)*end[1]) * 0x10000);
+	*s = (int)((d_skytemp + 6*(SKYSIZE/2-1)*end[0]) * 0x10000);
+	*t = (int)((d_skytemp + 6*(SKYSIZE/2-1)*end[1]) * 0x10000);
 }
 
 
 /*
 =================
 D_DrawSkyScans8
+
+r_skysource holds the front layer on the left of each 256-byte scan and the
+back layer on the right; the front layer scrolls by d_skyshift over the back
+one and wherever it is 0 the back layer shows through
 =================
 */
 void D_DrawSkyScans8 (espan_t *pspan)
 {
 	int				count, spancount, u, v;
-	unsigned char	*pdest;
-	fixed16_t		s, t, snext, tnext, sstep, tstep;
+	unsigned char	*pdest, *back, pix;
+	fixed16_t		s, t, snext, tnext, sstep, tstep, shift;
 	int				spancountminus1;
 
 	sstep = 0;	// keep compiler happy
 	tstep = 0;	// ditto
 
+	D_SkySetupFrame ();
+
+	shift = d_skyshift;
+	back = r_skysource + 128;
+
 	do
 	{
 		pdest = (unsigned char *)((byte *)d_viewbuffer +
@@ -82,6 +169,7 @@ void D_DrawSkyScans8 (espan_t *pspan)
 	// calculate the initial s & t
 		u = pspan->u;
 		v = pspan->v;
+		D_SkySetupRow (v);
 		D_Sky_uv_To_st (u, v, &s, &t);
 
 		do
@@ -122,8 +210,12 @@ void D_DrawSkyScans8 (espan_t *pspan)
 
 			do
 			{
-				*pdest++ = r_skysource[((t & R_SKY_TMASK) >> 8) +
-						((s & R_SKY_SMASK) >> 16)];
+				pix = r_skysource[(((t + shift) & R_SKY_TMASK) >> 8) +
+						(((s + shift) & R_SKY_SMASK) >> 16)];
+				if (!pix)
+					pix = back[((t & R_SKY_TMASK) >> 8) +
+							((s & R_SKY_SMASK) >> 16)];
+				*pdest++ = pix;
 				s += sstep;
 				t += tstep;
 			} while (--spancount > 0);
@@ -57,6 +57,9 @@ void D_SpriteDrawSpans (sspan_t *pspan)
 
 	do
 	{
+		if ((pspan->v < d_tiley0) || (pspan->v >= d_tiley1))
+			goto NextSpan;
+
 		pdest = (byte *)d_viewbuffer + (screenwidth * pspan->v) + pspan->u;
 		pz = d_pzbuffer + (d_zwidth * pspan->v) + pspan->u;
 
@@ -435,3 +438,105 @@ void D_DrawSprite (void)
 	D_SpriteDrawSpans (sprite_spans);
 }
 
+
+/*
+=====================
+D_DrawSpriteRect
+
+Draws r_spritedesc as the screen rectangle R_DrawSpriteRect worked out, at
+the constant depth r_spritedesc.nearzi, stepping s and t in fixed point
+=====================
+*/
+void D_DrawSpriteRect (void)
+{
+	int			u, v, u0, u1, v0, v1, count, izi, width, height;
+	byte		*pbase, *psource, *pdest, btemp;
+	short		*pz;
+	fixed16_t	s, t, s0, sstep, tstep, smax, tmax;
+	float		uscale, vscale;
+
+	width = r_spritedesc.pspriteframe->width;
+	height = r_spritedesc.pspriteframe->height;
+	pbase = (byte *)&r_spritedesc.pspriteframe->pixels[0];
+
+	if ((r_spritedesc.rectright <= r_spritedesc.rectleft) ||
+		(r_spritedesc.rectbottom <= r_spritedesc.recttop))
+	{
+		return;
+	}
+
+// pixels whose left/top edges are in the rectangle, clipped to the view and
+// to the current band
+	u0 = (int)ceil (r_spritedesc.rectleft);
+	u1 = (int)ceil (r_spritedesc.rectright);
+	v0 = (int)ceil (r_spritedesc.recttop);
+	v1 = (int)ceil (r_spritedesc.rectbottom);
+
+	if (u0 < r_refdef.vrect.x)
+		u0 = r_refdef.vrect.x;
+	if (u1 > r_refdef.vrectright)
+		u1 = r_refdef.vrectright;
+	if (v0 < r_refdef.vrect.y)
+		v0 = r_refdef.vrect.y;
+	if (v1 > r_refdef.vrectbottom)
+		v1 = r_refdef.vrectbottom;
+	if (v0 < d_tiley0)
+		v0 = d_tiley0;
+	if (v1 > d_tiley1)
+		v1 = d_tiley1;
+
+	if ((u0 >= u1) || (v0 >= v1))
+		return;
+
+	uscale = (float)width * 0x10000 /
+			(r_spritedesc.rectright - r_spritedesc.rectleft);
+	vscale = (float)height * 0x10000 /
+			(r_spritedesc.rectbottom - r_spritedesc.recttop);
+
+	sstep = (int)uscale;
+	tstep = (int)vscale;
+
+// -1 (-epsilon) so we never wander off the edge of the texture
+	smax = (width << 16) - 1;
+	tmax = (height << 16) - 1;
+
+	s0 = (int)(((float)u0 - r_spritedesc.rectleft) * uscale);
+	if (s0 < 0)
+		s0 = 0;
+	else if (s0 > smax)
+		s0 = smax;
+
+	count = u1 - u0;
+	if ((count > 1) && (s0 + sstep * (count - 1) > smax))
+		sstep = (smax - s0) / (count - 1);
+
+	t = (int)(((float)v0 - r_spritedesc.recttop) * vscale);
+	if (t < 0)
+		t = 0;
+
+// there's no z gradient, so every pixel gets the same z
+	izi = (int)(r_spritedesc.nearzi * 0x8000);
+
+	for (v=v0 ; v<v1 ; v++, t += tstep)
+	{
+		if (t > tmax)
+			t = tmax;
+
+		psource = pbase + (t >> 16) * width;
+		pdest = (byte *)d_viewbuffer + (screenwidth * v) + u0;
+		pz = d_pzbuffer + (d_zwidth * v) + u0;
+
+		for (u=0, s=s0 ; u<count ; u++, s += sstep)
+		{
+			btemp = psource[s >> 16];
+			if (btemp != 255)
+			{
+				if (pz[u] <= izi)
+				{
+					pz[u] = izi;
+					pdest[u] = btemp;
+				}
+			}
+		}
+	}
+}
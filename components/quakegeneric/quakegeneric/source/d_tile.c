@@ -0,0 +1,209 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// d_tile.c: banded rendering into a small scratch color/z target
+//
+// The frame, z buffer and surface cache live in external RAM on the handheld,
+// so instead of drawing the whole view into them, the view can be drawn one
+// horizontal band at a time into the buffers below, which stay in internal
+// RAM, and each finished band is copied out to the frame once.
+//
+// While a band is active, d_viewbuffer, d_pzbuffer and zspantable are biased
+// so that absolute screen rows inside the band land in the scratch buffers;
+// the rasterizers reject anything outside [d_tiley0, d_tiley1).
+
+#include "quakedef.h"
+#include "r_local.h"
+#include "d_local.h"
+
+cvar_t	d_tiled = {"d_tiled", "0"};
+cvar_t	d_tilestats = {"d_tilestats", "0"};
+
+qboolean	d_tiling;
+int			d_tiley0, d_tiley1;
+short		*d_pzscissor0, *d_pzscissor1;
+
+int			d_tilecount;
+int			d_tilewritebytes, d_framewritebytes;
+
+static byte		d_tilebuffer[D_TILE_HEIGHT * WARP_WIDTH];
+static short	d_tilezbuffer[D_TILE_HEIGHT * WARP_WIDTH];
+
+static pixel_t	*d_frameviewbuffer;
+static short	*d_framezbuffer;
+
+
+/*
+===============
+D_SetFullScissor
+===============
+*/
+void D_SetFullScissor (void)
+{
+	d_tiley0 = 0;
+	d_tiley1 = vid.height;
+	d_pzscissor0 = d_pzbuffer;
+	d_pzscissor1 = d_pzbuffer + vid.height * d_zwidth;
+
+	D_InvalidateCoarseZ ();
+}
+
+
+/*
+===============
+D_BeginTiles
+
+Returns false if the view can't be banded, in which case the frame is drawn
+directly as usual
+===============
+*/
+qboolean D_BeginTiles (void)
+{
+	d_tiling = false;
+
+	if (!d_tiled.value)
+		return false;
+	if ((screenwidth > WARP_WIDTH) || (d_zwidth > WARP_WIDTH))
+		return false;
+
+	d_frameviewbuffer = d_viewbuffer;
+	d_framezbuffer = d_pzbuffer;
+	d_tilecount = 0;
+	d_tiling = true;
+
+	return true;
+}
+
+
+/*
+===============
+D_SetTile
+
+Points the rasterizers at the scratch buffers for rows y0 to y1-1
+===============
+*/
+void D_SetTile (int y0, int y1)
+{
+	int		i;
+
+	d_tiley0 = y0;
+	d_tiley1 = y1;
+
+	d_viewbuffer = (pixel_t *)d_tilebuffer - d_scantable[y0];
+	d_pzbuffer = d_tilezbuffer - y0 * d_zwidth;
+	d_pzscissor0 = d_tilezbuffer;
+	d_pzscissor1 = d_tilezbuffer + (y1 - y0) * d_zwidth;
+
+	for (i=y0 ; i<y1 ; i++)
+		zspantable[i] = d_pzbuffer + i * d_zwidth;
+
+	D_InvalidateCoarseZ ();
+
+	d_tilecount++;
+}
+
+
+/*
+===============
+D_FlushTile
+
+Copies the view columns of the current band out to the frame
+===============
+*/
+void D_FlushTile (void)
+{
+	int		v, width;
+	byte	*src, *dest;
+
+	width = r_refdef.vrectright - r_refdef.vrect.x;
+
+	for (v=d_tiley0 ; v<d_tiley1 ; v++)
+	{
+		src = (byte *)d_viewbuffer + d_scantable[v] + r_refdef.vrect.x;
+		dest = (byte *)d_frameviewbuffer + d_scantable[v] + r_refdef.vrect.x;
+		memcpy (dest, src, width);
+	}
+
+	d_framewritebytes += width * (d_tiley1 - d_tiley0);
+}
+
+
+/*
+===============
+D_EndTiles
+===============
+*/
+void D_EndTiles (void)
+{
+	int		i;
+
+	if (!d_tiling)
+		return;
+
+	d_viewbuffer = d_frameviewbuffer;
+	d_pzbuffer = d_framezbuffer;
+
+	for (i=0 ; i<vid.height ; i++)
+		zspantable[i] = d_pzbuffer + i * d_zwidth;
+
+	D_SetFullScissor ();
+
+	d_tiling = false;
+}
+
+
+/*
+===============
+D_CountSpanWrites
+
+Tallies the bytes a span list writes to color and z, split by whether they
+land in the scratch band or go straight to the frame
+===============
+*/
+void D_CountSpanWrites (espan_t *pspan)
+{
+	int		count;
+
+	count = 0;
+	for ( ; pspan ; pspan = pspan->pnext)
+		count += pspan->count;
+
+	count *= sizeof(pixel_t) + sizeof(short);
+
+	if (d_tiling)
+		d_tilewritebytes += count;
+	else
+		d_framewritebytes += count;
+}
+
+
+/*
+===============
+D_PrintTileStats
+===============
+*/
+void D_PrintTileStats (void)
+{
+	Con_Printf ("%2i tiles %4ik scratch %4ik frame\n", d_tilecount,
+			d_tilewritebytes >> 10, d_framewritebytes >> 10);
+
+	d_tilecount = 0;
+	d_tilewritebytes = 0;
+	d_framewritebytes = 0;
+}
@@ -46,6 +46,7 @@ typedef struct cachepic_s
 {
 	char		name[MAX_QPATH];
 	cache_user_t	cache;
+	qpic_t		*registered;	// address its run list was made for
 } cachepic_t;
 
 #define	MAX_CACHED_PICS		128
@@ -53,9 +54,356 @@ EXT_RAM_BSS_ATTR cachepic_t	menu_cachepics[MAX_CACHED_PICS];
 int			menu_numcachepics;
 
 
+/*
+===============================================================================
+
+TRANSPARENT PICS
+
+Pics handed out by Draw_PicFromWad and Draw_CachePic are looked over once,
+and those with transparent pixels get a run list: per row, pairs of
+transparent and opaque run lengths ended by an empty opaque run, followed by
+the opaque pixels packed together.  Draw_TransPic then memcpy's each opaque
+run and steps over the rest, and draws fully opaque pics as Draw_Pic does.
+
+The run lists live in the cache and are rebuilt if flushed.  They're found
+by pic address, so a cache pic is registered again whenever Draw_CachePic
+sees it at a new one.
+
+Draw_TransPicTranslate keeps a few run lists with the translation already
+applied, for the same pic and table drawn frame after frame.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	unsigned short	skip, count;	// transparent, then opaque pixels
+} picrun_t;
+
+typedef struct
+{
+	int		width, height;
+	int		pixelofs;			// from the start of this header
+} picruns_t;
+
+typedef struct
+{
+	qpic_t			*pic;		// NULL if free, DELETED_PIC if forgotten
+	void			*owner;		// cachepic_t that registered it, or NULL
+	qboolean		opaque;
+	cache_user_t	cache;		// picruns_t, if not opaque
+} transpic_t;
+
+#define	MAX_TRANSPICS		512		// power of two
+#define	DELETED_PIC			((qpic_t *)-1)
+
+static transpic_t	draw_transpics[MAX_TRANSPICS];
+
+typedef struct
+{
+	qpic_t			*pic;
+	byte			translation[256];
+	cache_user_t	cache;		// picruns_t with translated pixels
+} translatedpic_t;
+
+#define	MAX_TRANSLATEDPICS	4
+
+static translatedpic_t	draw_translated[MAX_TRANSLATEDPICS];
+static int				draw_nexttranslated;
+
+/*
+================
+Draw_FindTransPic
+
+Returns the pic's record, or if it has none and insert is set a free one,
+or NULL
+================
+*/
+static transpic_t *Draw_FindTransPic (qpic_t *pic, qboolean insert)
+{
+	int			i, h;
+	transpic_t	*tp, *free;
+
+	h = ((uintptr_t)pic >> 3) & (MAX_TRANSPICS-1);
+	free = NULL;
+
+	for (i=0 ; i<MAX_TRANSPICS ; i++)
+	{
+		tp = &draw_transpics[(h + i) & (MAX_TRANSPICS-1)];
+		if (tp->pic == pic)
+			return tp;
+		if (tp->pic == DELETED_PIC)
+		{
+			if (!free)
+				free = tp;
+			continue;
+		}
+		if (!tp->pic)
+		{
+			if (!free)
+				free = tp;
+			break;
+		}
+	}
+
+	return insert ? free : NULL;
+}
+
+/*
+================
+Draw_BuildRuns
+
+Builds the run list for a pic in c, with its pixels put through translation
+if there is one
+================
+*/
+static picruns_t *Draw_BuildRuns (qpic_t *pic, byte *translation,
+	cache_user_t *c)
+{
+	int			u, v, start, last, numruns, numpixels;
+	byte		*source, *pixels;
+	picrun_t	*run;
+	picruns_t	*pr;
+
+	numruns = 0;
+	numpixels = 0;
+
+	for (v=0, source=pic->data ; v<pic->height ; v++, source += pic->width)
+	{
+		u = 0;
+		while (1)
+		{
+			while (u < pic->width && source[u] == TRANSPARENT_COLOR)
+				u++;
+			if (u == pic->width)
+				break;
+			start = u;
+			while (u < pic->width && source[u] != TRANSPARENT_COLOR)
+				u++;
+			numruns++;
+			numpixels += u - start;
+		}
+		numruns++;		// end of row
+	}
+
+	pr = Cache_Alloc (c, sizeof(picruns_t) + numruns*sizeof(picrun_t)
+			+ numpixels, "picruns");
+	if (!pr)
+		return NULL;
+
+	pr->width = pic->width;
+	pr->height = pic->height;
+	pr->pixelofs = sizeof(picruns_t) + numruns*sizeof(picrun_t);
+
+	run = (picrun_t *)(pr + 1);
+	pixels = (byte *)pr + pr->pixelofs;
+
+	for (v=0, source=pic->data ; v<pic->height ; v++, source += pic->width)
+	{
+		u = 0;
+		last = 0;
+		while (1)
+		{
+			while (u < pic->width && source[u] == TRANSPARENT_COLOR)
+				u++;
+			if (u == pic->width)
+				break;
+			start = u;
+			while (u < pic->width && source[u] != TRANSPARENT_COLOR)
+			{
+				*pixels++ = translation ? translation[source[u]] : source[u];
+				u++;
+			}
+			run->skip = start - last;
+			run->count = u - start;
+			run++;
+			last = u;
+		}
+		run->skip = 0;
+		run->count = 0;
+		run++;
+	}
+
+	return pr;
+}
+
+/*
+================
+Draw_RegisterPic
+
+Gives a pic that may be drawn with Draw_TransPic a record, building its run
+list if it needs one
+================
+*/
+static void Draw_RegisterPic (qpic_t *pic, void *owner)
+{
+	int			i;
+	transpic_t	*tp;
+
+	for (i=0 ; i<MAX_TRANSLATEDPICS ; i++)
+		if (draw_translated[i].pic == pic)
+			draw_translated[i].pic = NULL;		// made for whatever was here
+
+	tp = Draw_FindTransPic (pic, true);
+	if (!tp)
+		return;			// full, so it's drawn the slow way
+
+	if (tp->pic == pic && tp->cache.data)
+		Cache_Free (&tp->cache);
+
+	tp->pic = pic;
+	tp->owner = owner;
+	tp->opaque = true;
+
+	for (i=0 ; i<pic->width*pic->height ; i++)
+	{
+		if (pic->data[i] == TRANSPARENT_COLOR)
+		{
+			tp->opaque = false;
+			Draw_BuildRuns (pic, NULL, &tp->cache);
+			break;
+		}
+	}
+}
+
+/*
+================
+Draw_ForgetPic
+
+Drops the record owner made for a pic that is no longer at that address
+================
+*/
+static void Draw_ForgetPic (qpic_t *pic, void *owner)
+{
+	transpic_t	*tp;
+
+	tp = Draw_FindTransPic (pic, false);
+	if (!tp || tp->owner != owner)
+		return;
+
+	if (tp->cache.data)
+		Cache_Free (&tp->cache);
+	tp->pic = DELETED_PIC;
+	tp->owner = NULL;
+}
+
+/*
+================
+Draw_Runs
+================
+*/
+static void Draw_Runs (byte *dest, picruns_t *pr)
+{
+	int			v;
+	byte		*pixels, *d;
+	picrun_t	*run;
+
+	run = (picrun_t *)(pr + 1);
+	pixels = (byte *)pr + pr->pixelofs;
+
+	for (v=0 ; v<pr->height ; v++, dest += vid.rowbytes)
+	{
+		for (d = dest ; run->count ; run++)
+		{
+			d += run->skip;
+			memcpy (d, pixels, run->count);
+			d += run->count;
+			pixels += run->count;
+		}
+		run++;
+	}
+}
+
+/*
+================
+Draw_TransPicRuns
+
+Draws a registered pic at dest; returns false if it isn't registered, or its
+run list can't be had
+================
+*/
+static qboolean Draw_TransPicRuns (byte *dest, qpic_t *pic)
+{
+	int			v;
+	transpic_t	*tp;
+	picruns_t	*pr;
+
+	tp = Draw_FindTransPic (pic, false);
+	if (!tp)
+		return false;
+	if (tp->owner && ((cachepic_t *)tp->owner)->cache.data != pic)
+		return false;	// flushed, and this isn't that pic any more
+
+	if (tp->opaque)
+	{
+		for (v=0 ; v<pic->height ; v++, dest += vid.rowbytes)
+			Q_memcpy (dest, pic->data + v*pic->width, pic->width);
+		return true;
+	}
+
+	pr = Cache_Check (&tp->cache);
+	if (!pr)
+		pr = Draw_BuildRuns (pic, NULL, &tp->cache);
+	if (!pr)
+		return false;
+
+	Draw_Runs (dest, pr);
+	return true;
+}
+
+/*
+================
+Draw_TranslatedRuns
+
+Finds or builds the run list for pic through translation
+================
+*/
+static picruns_t *Draw_TranslatedRuns (qpic_t *pic, byte *translation)
+{
+	int				i;
+	translatedpic_t	*tr;
+	picruns_t		*pr;
+
+	for (i=0, tr=draw_translated ; i<MAX_TRANSLATEDPICS ; i++, tr++)
+	{
+		if (tr->pic != pic || memcmp (tr->translation, translation, 256))
+			continue;
+		pr = Cache_Check (&tr->cache);
+		if (pr && pr->width == pic->width && pr->height == pic->height)
+			return pr;
+		break;
+	}
+
+	if (i == MAX_TRANSLATEDPICS)
+	{
+		tr = &draw_translated[draw_nexttranslated];
+		draw_nexttranslated = (draw_nexttranslated + 1) % MAX_TRANSLATEDPICS;
+	}
+
+	if (tr->cache.data)
+		Cache_Free (&tr->cache);
+
+	tr->pic = pic;
+	memcpy (tr->translation, translation, 256);
+
+	return Draw_BuildRuns (pic, translation, &tr->cache);
+}
+
+
+/*
+================
+Draw_PicFromWad
+================
+*/
 qpic_t	*Draw_PicFromWad (char *name)
 {
-	return W_GetLumpName (name);
+	qpic_t	*pic;
+
+	pic = W_GetLumpName (name);
+	if (!Draw_FindTransPic (pic, false))
+		Draw_RegisterPic (pic, NULL);
+
+	return pic;
 }
 
 /*
@@ -84,7 +432,16 @@ qpic_t	*Draw_CachePic (char *path)
 	dat = Cache_Check (&pic->cache);
 
 	if (dat)
+	{
+		if (dat != pic->registered)
+		{	// moved since it was registered
+			if (pic->registered)
+				Draw_ForgetPic (pic->registered, pic);
+			Draw_RegisterPic (dat, pic);
+			pic->registered = dat;
+		}
 		return dat;
+	}
 
 //
 // load the pic from disk
@@ -99,11 +456,155 @@ qpic_t	*Draw_CachePic (char *path)
 
 	SwapPic (dat);
 
+	if (pic->registered)
+		Draw_ForgetPic (pic->registered, pic);
+	Draw_RegisterPic (dat, pic);
+	pic->registered = dat;
+
 	return dat;
 }
 
 
 
+/*
+===============================================================================
+
+GLYPHS
+
+conchars is expanded once into a colour word and a mask word for each half of
+each glyph row, so a row goes to the screen as two masked word writes instead
+of eight tested bytes.  Glyphs with nothing opaque in them, the space most of
+all, are skipped outright.  Destinations that aren't word aligned fall back
+to bytes.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	unsigned	color[2];
+	unsigned	mask[2];		// bytes the glyph leaves alone are 0xff
+} glyphrow_t;
+
+static glyphrow_t	*draw_glyphs;			// [256][8]
+static byte			draw_glyphempty[256];
+
+/*
+===============
+Draw_InitGlyphs
+===============
+*/
+static void Draw_InitGlyphs (void)
+{
+	int			num, y, x;
+	byte		*source, color[8], mask[8];
+	glyphrow_t	*g;
+
+	draw_glyphs = Hunk_AllocName (256 * 8 * sizeof(glyphrow_t), "glyphs");
+
+	for (num=0 ; num<256 ; num++)
+	{
+		source = draw_chars + ((num>>4)<<10) + ((num&15)<<3);
+		g = draw_glyphs + num*8;
+		draw_glyphempty[num] = true;
+
+		for (y=0 ; y<8 ; y++, source += 128, g++)
+		{
+			for (x=0 ; x<8 ; x++)
+			{
+				color[x] = source[x];
+				mask[x] = source[x] ? 0 : 0xff;
+				if (source[x])
+					draw_glyphempty[num] = false;
+			}
+
+		// byte order comes out right whatever the machine's is
+			memcpy (g->color, color, 8);
+			memcpy (g->mask, mask, 8);
+		}
+	}
+}
+
+/*
+================
+Draw_Glyph
+
+Draws rows first to first+count-1 of a glyph, which must not be empty
+================
+*/
+static void Draw_Glyph (byte *dest, int num, int first, int count)
+{
+	glyphrow_t	*g;
+	unsigned	*pdest;
+	byte		*source;
+	int			x;
+
+	if ((intptr_t)dest & 3)
+	{
+		source = draw_chars + ((num>>4)<<10) + ((num&15)<<3) + first*128;
+		while (count--)
+		{
+			for (x=0 ; x<8 ; x++)
+				if (source[x])
+					dest[x] = source[x];
+			source += 128;
+			dest += vid.conrowbytes;
+		}
+		return;
+	}
+
+	g = draw_glyphs + num*8 + first;
+	while (count--)
+	{
+		pdest = (unsigned *)dest;
+		pdest[0] = (pdest[0] & g->mask[0]) | g->color[0];
+		pdest[1] = (pdest[1] & g->mask[1]) | g->color[1];
+		g++;
+		dest += vid.conrowbytes;
+	}
+}
+
+/*
+================
+Draw_Text
+
+Draws count characters from text, each offset by add, in one pass.  Like
+Draw_Character it can be clipped to the top of the screen.
+================
+*/
+void Draw_Text (int x, int y, char *text, int count, int add)
+{
+	byte	*dest;
+	int		first, num;
+
+	if (y <= -8)
+		return;			// totally off screen
+
+#ifdef PARANOID
+	if (y > vid.height - 8 || x < 0 || x + count*8 > vid.width)
+		Sys_Error ("Draw_Text: (%i, %i)", x, y);
+#endif
+
+	if (y < 0)
+	{	// clipped
+		first = -y;
+		y = 0;
+	}
+	else
+		first = 0;
+
+	dest = vid.conbuffer + y*vid.conrowbytes + x;
+
+	for ( ; count > 0 ; count--, text++, dest += 8)
+	{
+		num = (*text + add) & 255;
+		if (!draw_glyphempty[num])
+			Draw_Glyph (dest, num, first, 8 - first);
+	}
+}
+
+
+
 /*
 ===============
 Draw_Init
@@ -117,6 +618,8 @@ void Draw_Init (void)
 	draw_disc = W_GetLumpName ("disc");
 	draw_backtile = W_GetLumpName ("backtile");
 
+	Draw_InitGlyphs ();
+
 	r_rectdesc.width = draw_backtile->width;
 	r_rectdesc.height = draw_backtile->height;
 	r_rectdesc.ptexbytes = draw_backtile->data;
@@ -136,11 +639,7 @@ smoothly scrolled off.
 */
 void Draw_Character (int x, int y, int num)
 {
-	byte			*dest;
-	byte			*source;
-	unsigned short	*pusdest;
-	int				drawline;	
-	int				row, col;
+	int		first;
 
 	num &= 255;
 	
@@ -154,42 +653,18 @@ void Draw_Character (int x, int y, int num)
 		Sys_Error ("Con_DrawCharacter: char %i", num);
 #endif
 
-	row = num>>4;
-	col = num&15;
-	source = draw_chars + (row<<10) + (col<<3);
+	if (draw_glyphempty[num])
+		return;
 
 	if (y < 0)
 	{	// clipped
-		drawline = 8 + y;
-		source -= 128*y;
+		first = -y;
 		y = 0;
 	}
 	else
-		drawline = 8;
+		first = 0;
 
-	dest = vid.conbuffer + y*vid.conrowbytes + x;
-	
-	while (drawline--)
-	{
-		if (source[0])
-			dest[0] = source[0];
-		if (source[1])
-			dest[1] = source[1];
-		if (source[2])
-			dest[2] = source[2];
-		if (source[3])
-			dest[3] = source[3];
-		if (source[4])
-			dest[4] = source[4];
-		if (source[5])
-			dest[5] = source[5];
-		if (source[6])
-			dest[6] = source[6];
-		if (source[7])
-			dest[7] = source[7];
-		source += 128;
-		dest += vid.conrowbytes;
-	}
+	Draw_Glyph (vid.conbuffer + y*vid.conrowbytes + x, num, first, 8 - first);
 }
 
 /*
@@ -199,12 +674,7 @@ Draw_String
 */
 void Draw_String (int x, int y, char *str)
 {
-	while (*str)
-	{
-		Draw_Character (x, y, *str);
-		str++;
-		x += 8;
-	}
+	Draw_Text (x, y, str, strlen (str), 0);
 }
 
 /*
@@ -303,6 +773,9 @@ void Draw_TransPic (int x, int y, qpic_t *pic)
 
 	dest = vid.buffer + y * vid.rowbytes + x;
 
+	if (Draw_TransPicRuns (dest, pic))
+		return;
+
 	if (pic->width & 7)
 	{	// general
 		for (v=0 ; v<pic->height ; v++)
@@ -356,6 +829,7 @@ void Draw_TransPicTranslate (int x, int y, qpic_t *pic, byte *translation)
 	byte	*dest, *source, tbyte;
 	unsigned short	*pusdest;
 	int				v, u;
+	picruns_t		*pr;
 
 	if (x < 0 || (unsigned)(x + pic->width) > vid.width || y < 0 ||
 		 (unsigned)(y + pic->height) > vid.height)
@@ -367,6 +841,13 @@ void Draw_TransPicTranslate (int x, int y, qpic_t *pic, byte *translation)
 
 	dest = vid.buffer + y * vid.rowbytes + x;
 
+	pr = Draw_TranslatedRuns (pic, translation);
+	if (pr)
+	{
+		Draw_Runs (dest, pr);
+		return;
+	}
+
 	if (pic->width & 7)
 	{	// general
 		for (v=0 ; v<pic->height ; v++)
@@ -435,11 +916,12 @@ void Draw_CharToConback (int num, byte *dest)
 
 /*
 ================
-Draw_ConsoleBackground
+Draw_ConsoleBackgroundRows
 
+Draws rows y0 to y1-1 of a console background lines tall
 ================
 */
-void Draw_ConsoleBackground (int lines)
+void Draw_ConsoleBackgroundRows (int lines, int y0, int y1)
 {
 	int				x, y, v;
 	byte			*src, *dest;
@@ -458,9 +940,9 @@ void Draw_ConsoleBackground (int lines)
 		Draw_CharToConback (ver[x], dest+(x<<3));
 	
 // draw the pic
-	dest = vid.conbuffer;
+	dest = vid.conbuffer + y0*vid.conrowbytes;
 
-	for (y=0 ; y<lines ; y++, dest += vid.conrowbytes)
+	for (y=y0 ; y<y1 ; y++, dest += vid.conrowbytes)
 	{
 		v = (vid.conheight - lines + y)*200/vid.conheight;
 		src = conback->data + v*320;
@@ -486,6 +968,18 @@ void Draw_ConsoleBackground (int lines)
 }
 
 
+/*
+================
+Draw_ConsoleBackground
+
+================
+*/
+void Draw_ConsoleBackground (int lines)
+{
+	Draw_ConsoleBackgroundRows (lines, 0, lines);
+}
+
+
 /*
 ==============
 R_DrawRect
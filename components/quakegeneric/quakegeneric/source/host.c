@@ -587,6 +587,9 @@ void _Host_Frame (float time)
 
 // keep the random time dependent
 	rand ();
+
+// move queued file reads along, even on frames that don't run
+	Sys_FileService ();
 	
 // decide the simulation time
 	if (!Host_FilterTime (time))
@@ -797,6 +800,7 @@ void Host_Init (quakeparms_t *parms)
 	com_argv = parms->argv;
 
 	Memory_Init (parms->membase, parms->memsize);
+	Memory_InitFast (parms->fastmembase, parms->fastmemsize);
 	Cbuf_Init ();
 	Cmd_Init ();
 	V_Init ();
@@ -823,7 +827,7 @@ void Host_Init (quakeparms_t *parms)
 		host_basepal = (byte *)COM_LoadHunkFile ("gfx/palette.lmp");
 		if (!host_basepal)
 			Sys_Error ("Couldn't load gfx/palette.lmp");
-		host_colormap = (byte *)COM_LoadHunkFile ("gfx/colormap.lmp");
+		host_colormap = (byte *)COM_LoadPlacedFile ("gfx/colormap.lmp");
 		if (!host_colormap)
 			Sys_Error ("Couldn't load gfx/colormap.lmp");
 
@@ -844,6 +848,8 @@ void Host_Init (quakeparms_t *parms)
 	host_hunklevel = Hunk_LowMark ();
 
 	host_initialized = true;
+
+	Memory_Report ();
 	
 	Sys_Printf ("========Quake Initialized=========\n");	
 }
@@ -24,6 +24,7 @@ OBJECTS=&
 	d_scan.o&
 	d_sky.o&
 	d_sprite.o&
+	d_tile.o&
 	d_surf.o&
 	d_vars.o&
 	d_zpoint.o&
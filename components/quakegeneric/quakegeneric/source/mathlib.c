@@ -154,6 +154,18 @@ float	anglemod(float a)
 	return a;
 }
 
+/*
+==================
+Q_rint
+
+Rounds to the nearest integer, halves away from zero
+==================
+*/
+int Q_rint (float x)
+{
+	return x > 0 ? (int)(x + 0.5) : (int)(x - 0.5);
+}
+
 /*
 ==================
 BOPS_Error
@@ -83,6 +83,7 @@ void M_ServerList_Key (int key);
 
 qboolean	m_entersound;		// play after drawing a frame, so caching
 								// won't disrupt the sound
+int			m_keycount;			// keys handled, for M_DrawKey
 qboolean	m_recursiveDraw;
 
 int			m_return_state;
@@ -112,22 +113,12 @@ void M_DrawCharacter (int cx, int line, int num)
 
 void M_Print (int cx, int cy, char *str)
 {
-	while (*str)
-	{
-		M_DrawCharacter (cx, cy, (*str)+128);
-		str++;
-		cx += 8;
-	}
+	Draw_Text (cx + ((vid.width - 320)>>1), cy, str, strlen (str), 128);
 }
 
 void M_PrintWhite (int cx, int cy, char *str)
 {
-	while (*str)
-	{
-		M_DrawCharacter (cx, cy, *str);
-		str++;
-		cx += 8;
-	}
+	Draw_Text (cx + ((vid.width - 320)>>1), cy, str, strlen (str), 0);
 }
 
 void M_DrawTransPic (int x, int y, qpic_t *pic)
@@ -2940,6 +2931,32 @@ void M_Init (void)
 }
 
 
+/*
+================
+M_DrawKey
+
+Returns 0 if M_Draw would draw nothing, otherwise a value that only changes
+when what it draws may have: on a key, a change of menu, or a tick of the
+cursor animations
+================
+*/
+int M_DrawKey (void)
+{
+	int		key;
+
+	if (m_state == m_none || key_dest != key_menu)
+		return 0;
+
+	key = m_state;
+	key = key * 31 + m_keycount;
+	key = key * 31 + m_entersound;
+	key = key * 31 + (int)(host_time * 10);
+	key = key * 31 + (int)(realtime * 4);
+
+	return key | 1;
+}
+
+
 void M_Draw (void)
 {
 	if (m_state == m_none || key_dest != key_menu)
@@ -3058,6 +3075,8 @@ void M_Draw (void)
 
 void M_Keydown (int key)
 {
+	m_keycount++;
+
 	switch (m_state)
 	{
 	case m_none:
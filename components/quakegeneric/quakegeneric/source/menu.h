@@ -33,6 +33,7 @@ extern	int	m_activenet;
 void M_Init (void);
 void M_Keydown (int key);
 void M_Draw (void);
+int M_DrawKey (void);
 void M_ToggleMenu_f (void);
 
 
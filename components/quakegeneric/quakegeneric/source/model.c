@@ -33,6 +33,12 @@ void Mod_LoadSpriteModel (model_t *mod, void *buffer);
 void Mod_LoadBrushModel (model_t *mod, void *buffer);
 void Mod_LoadAliasModel (model_t *mod, void *buffer);
 model_t *Mod_LoadModel (model_t *mod, qboolean crash);
+qboolean Mod_LoadMapCache (model_t *mod);
+void Mod_MapCacheCRC (unsigned short *crc, byte *data, int len);
+void Mod_SaveMapCache (model_t *mod, int mark, unsigned short crc, int filesize);
+void Mod_SetupSubmodels (model_t *mod);
+
+cvar_t	mod_mapcache = {"mod_mapcache", "0", true};
 
 byte	mod_novis[MAX_MAP_LEAFS/8];
 
@@ -52,6 +58,8 @@ Mod_Init
 */
 void Mod_Init (void)
 {
+	Cvar_RegisterVariable (&mod_mapcache);
+
 	memset (mod_novis, 0xff, sizeof(mod_novis));
 }
 
@@ -276,6 +284,8 @@ model_t *Mod_LoadModel (model_t *mod, qboolean crash)
 //
 // because the world is so huge, load it one piece at a time
 //
+	if (Mod_LoadMapCache (mod))
+		return mod;
 	
 //
 // load the file
@@ -1143,9 +1153,10 @@ Mod_LoadBrushModel
 */
 void Mod_LoadBrushModel (model_t *mod, void *buffer)
 {
-	int			i, j;
+	int			i;
 	dheader_t	*header;
-	dmodel_t 	*bm;
+	int			mark, filesize;
+	unsigned short	crc;
 	
 	loadmodel->type = mod_brush;
 	
@@ -1155,6 +1166,16 @@ void Mod_LoadBrushModel (model_t *mod, void *buffer)
 	if (i != BSPVERSION)
 		Sys_Error ("Mod_LoadBrushModel: %s has wrong version number (%i should be %i)", mod->name, i, BSPVERSION);
 
+	filesize = com_filesize;
+	crc = 0;
+	if (mod_mapcache.value)
+	{
+		CRC_Init (&crc);
+		Mod_MapCacheCRC (&crc, buffer, filesize);
+		crc = CRC_Value (crc);
+	}
+	mark = Hunk_LowMark ();
+
 // swap all the lumps
 	mod_base = (byte *)header;
 
@@ -1183,10 +1204,25 @@ void Mod_LoadBrushModel (model_t *mod, void *buffer)
 	
 	mod->numframes = 2;		// regular and alternate animation
 	mod->flags = 0;
-	
-//
-// set up the submodels (FIXME: this is confusing)
-//
+
+	if (mod_mapcache.value)
+		Mod_SaveMapCache (mod, mark, crc, filesize);
+
+	Mod_SetupSubmodels (mod);
+}
+
+/*
+=================
+Mod_SetupSubmodels
+
+Set up the submodels (FIXME: this is confusing)
+=================
+*/
+void Mod_SetupSubmodels (model_t *mod)
+{
+	int			i, j;
+	dmodel_t 	*bm;
+
 	for (i=0 ; i<mod->numsubmodels ; i++)
 	{
 		bm = &mod->submodels[i];
@@ -1220,6 +1256,429 @@ void Mod_LoadBrushModel (model_t *mod, void *buffer)
 	}
 }
 
+/*
+===============================================================================
+
+					MAP CACHE
+
+With mod_mapcache set, the fully fixed up hunk data of a freshly loaded map is
+written to <gamedir>/mapcache/<map>.mpc, and later loads of the same map read
+it back into the hunk with one sequential read instead of parsing the bsp.
+
+The file is keyed by a crc of the bsp header (the lump directory) and the bsp
+size, so the bsp itself never has to be read through to check it.  Pointers
+into the data are stored as offset+1 from the start of the data (0 stays
+NULL), which makes the image relocatable.  The image is native byte order and
+struct layout; the struct sizes are stored to reject foreign files.
+
+===============================================================================
+*/
+
+#define	MAPCACHE_IDENT		(('C'<<24)+('P'<<16)+('M'<<8)+'Q')
+#define	MAPCACHE_VERSION	2		// 2: keyed on the whole bsp
+
+#define	MAPCACHE_NOTEXTURE	((void *)-1)	// stands for r_notexture_mip
+
+#define	MAPCACHE_CRCBLOCK	0x10000		// bsp bytes read at a time to check the key
+
+typedef struct
+{
+	int				ident;
+	int				version;
+	int				sizes[8];		// struct layout check
+	int				bspsize;
+	unsigned short	bspcrc;
+	int				datasize;		// bytes of hunk data following the header
+	model_t			model;			// swizzled
+} mapcache_t;
+
+static byte		*swz_base;
+static int		swz_size;
+static qboolean	swz_save;		// pointers -> offsets, otherwise back
+static qboolean	swz_check;		// only look for pointers that can't be saved
+static qboolean	swz_bad;		// a pointer or offset was out of range
+
+/*
+=================
+Mod_MapCacheCRC
+
+Runs len bytes of the bsp through crc; the cache is keyed on the whole file
+=================
+*/
+void Mod_MapCacheCRC (unsigned short *crc, byte *data, int len)
+{
+	int		i;
+
+	for (i=0 ; i<len ; i++)
+		CRC_ProcessByte (crc, data[i]);
+}
+
+/*
+=================
+Mod_MapCacheFileCRC
+
+Reads the bsp through to key it without parsing any of it; returns -1 if it
+can't be read
+=================
+*/
+static int Mod_MapCacheFileCRC (char *name, int *size)
+{
+	unsigned short	crc;
+	int		h, len, mark, i, n;
+	byte	*buf;
+
+	len = COM_OpenFile (name, &h);
+	if (h == -1)
+		return -1;
+	Sys_FileReadAhead (h, len);
+
+	mark = Hunk_LowMark ();
+	buf = Hunk_AllocName (MAPCACHE_CRCBLOCK, "mapcrc");
+
+	CRC_Init (&crc);
+	for (i=0 ; i<len ; i+=n)
+	{
+		n = len - i;
+		if (n > MAPCACHE_CRCBLOCK)
+			n = MAPCACHE_CRCBLOCK;
+		if (Sys_FileRead (h, buf, n) != n)
+			break;
+		Mod_MapCacheCRC (&crc, buf, n);
+	}
+
+	Hunk_FreeToLowMark (mark);
+	COM_CloseFile (h);
+
+	*size = len;
+	return i < len ? -1 : CRC_Value (crc);
+}
+
+/*
+=================
+Mod_MapCacheSizes
+=================
+*/
+static void Mod_MapCacheSizes (int *sizes)
+{
+	sizes[0] = sizeof(void *);
+	sizes[1] = sizeof(model_t);
+	sizes[2] = sizeof(msurface_t);
+	sizes[3] = sizeof(mnode_t);
+	sizes[4] = sizeof(mleaf_t);
+	sizes[5] = sizeof(texture_t);
+	sizes[6] = sizeof(mtexinfo_t);
+	sizes[7] = sizeof(medge_t);
+}
+
+/*
+=================
+Mod_Swizzle
+=================
+*/
+static void Mod_Swizzle (void **p)
+{
+	size_t	ofs;
+
+	if (!*p)
+		return;
+
+	if (swz_save)
+	{
+		if (*p == r_notexture_mip)
+		{
+			if (!swz_check)
+				*p = MAPCACHE_NOTEXTURE;
+			return;
+		}
+		if ((byte *)*p < swz_base || (byte *)*p > swz_base + swz_size)
+		{
+			swz_bad = true;
+			return;
+		}
+		if (!swz_check)
+			*p = (void *)((byte *)*p - swz_base + 1);
+	}
+	else
+	{
+		if (*p == MAPCACHE_NOTEXTURE)
+		{
+			*p = r_notexture_mip;
+			return;
+		}
+		ofs = (size_t)*p - 1;
+		if (ofs > swz_size)
+		{
+			swz_bad = true;
+			*p = NULL;
+			return;
+		}
+		*p = swz_base + ofs;
+	}
+}
+
+/*
+=================
+Mod_SwizzleModel
+
+The pointers held by the model itself
+=================
+*/
+static void Mod_SwizzleModel (model_t *m)
+{
+	int		i;
+
+	Mod_Swizzle ((void **)&m->submodels);
+	Mod_Swizzle ((void **)&m->planes);
+	Mod_Swizzle ((void **)&m->leafs);
+	Mod_Swizzle ((void **)&m->vertexes);
+	Mod_Swizzle ((void **)&m->edges);
+	Mod_Swizzle ((void **)&m->nodes);
+	Mod_Swizzle ((void **)&m->texinfo);
+	Mod_Swizzle ((void **)&m->surfaces);
+	Mod_Swizzle ((void **)&m->surfedges);
+	Mod_Swizzle ((void **)&m->clipnodes);
+	Mod_Swizzle ((void **)&m->marksurfaces);
+	for (i=0 ; i<MAX_MAP_HULLS ; i++)
+	{
+		Mod_Swizzle ((void **)&m->hulls[i].clipnodes);
+		Mod_Swizzle ((void **)&m->hulls[i].planes);
+	}
+	Mod_Swizzle ((void **)&m->textures);
+	Mod_Swizzle ((void **)&m->visdata);
+	Mod_Swizzle ((void **)&m->lightdata);
+	Mod_Swizzle ((void **)&m->entities);
+}
+
+/*
+=================
+Mod_SwizzleData
+
+The pointers inside the hunk data; m's own pointers must be live
+=================
+*/
+static void Mod_SwizzleData (model_t *m)
+{
+	int			i, j;
+	texture_t	*tx;
+	msurface_t	*surf;
+	mleaf_t		*leaf;
+	mnode_t		*node;
+
+	if (m->textures)
+	{
+		for (i=0 ; i<m->numtextures ; i++)
+		{
+			if (!swz_save)
+				Mod_Swizzle ((void **)&m->textures[i]);
+			tx = m->textures[i];
+			if (tx)
+			{
+				Mod_Swizzle ((void **)&tx->anim_next);
+				Mod_Swizzle ((void **)&tx->alternate_anims);
+			}
+			if (swz_save)
+				Mod_Swizzle ((void **)&m->textures[i]);
+		}
+	}
+
+	for (i=0 ; i<m->numtexinfo ; i++)
+		Mod_Swizzle ((void **)&m->texinfo[i].texture);
+
+	for (i=0, surf=m->surfaces ; i<m->numsurfaces ; i++, surf++)
+	{
+		Mod_Swizzle ((void **)&surf->plane);
+		Mod_Swizzle ((void **)&surf->texinfo);
+		Mod_Swizzle ((void **)&surf->samples);
+		for (j=0 ; j<MIPLEVELS ; j++)
+			surf->cachespots[j] = NULL;
+	}
+
+	for (i=0 ; i<m->nummarksurfaces ; i++)
+		Mod_Swizzle ((void **)&m->marksurfaces[i]);
+
+	for (i=0, leaf=m->leafs ; i<m->numleafs ; i++, leaf++)
+	{
+		Mod_Swizzle ((void **)&leaf->parent);
+		Mod_Swizzle ((void **)&leaf->compressed_vis);
+		Mod_Swizzle ((void **)&leaf->firstmarksurface);
+		leaf->efrags = NULL;
+	}
+
+	for (i=0, node=m->nodes ; i<m->numnodes ; i++, node++)
+	{
+		Mod_Swizzle ((void **)&node->parent);
+		Mod_Swizzle ((void **)&node->plane);
+		Mod_Swizzle ((void **)&node->children[0]);
+		Mod_Swizzle ((void **)&node->children[1]);
+	}
+}
+
+/*
+=================
+Mod_MapCachePath
+=================
+*/
+static char *Mod_MapCachePath (void)
+{
+	return va("%s/mapcache/%s.mpc", com_gamedir, loadname);
+}
+
+/*
+=================
+Mod_SaveMapCache
+
+Called right after the lumps are loaded, while the hunk data from mark up is
+still exactly what the loaders left
+=================
+*/
+void Mod_SaveMapCache (model_t *mod, int mark, unsigned short crc, int filesize)
+{
+	static mapcache_t	cache;
+	int			handle;
+
+	swz_base = Hunk_LowPointer (mark);
+	swz_size = (byte *)Hunk_LowPointer (Hunk_LowMark ()) - swz_base;
+
+// a pointer outside the data can't be stored; look before changing anything
+	swz_save = true;
+	swz_check = true;
+	swz_bad = false;
+	cache.model = *mod;
+	Mod_SwizzleModel (&cache.model);
+	Mod_SwizzleData (mod);
+	swz_check = false;
+	swz_save = false;
+	if (swz_bad)
+	{
+		Con_Printf ("%s points outside its hunk data, not cached\n", mod->name);
+		return;
+	}
+
+	Sys_mkdir (va("%s/mapcache", com_gamedir));
+	handle = Sys_FileOpenWrite (Mod_MapCachePath ());
+	if (handle == -1)
+	{
+		Con_Printf ("Couldn't write %s\n", Mod_MapCachePath ());
+		return;
+	}
+
+	memset (&cache, 0, sizeof(cache));
+	cache.ident = MAPCACHE_IDENT;
+	cache.version = MAPCACHE_VERSION;
+	Mod_MapCacheSizes (cache.sizes);
+	cache.bspsize = filesize;
+	cache.bspcrc = crc;
+	cache.datasize = swz_size;
+
+	swz_save = true;
+	cache.model = *mod;
+	Mod_SwizzleModel (&cache.model);
+	Mod_SwizzleData (mod);
+
+	Sys_FileWrite (handle, &cache, sizeof(cache));
+	Sys_FileWrite (handle, swz_base, swz_size);
+	Sys_FileClose (handle);
+
+	swz_save = false;
+	Mod_SwizzleData (mod);
+
+	Con_DPrintf ("wrote %s (%ik)\n", Mod_MapCachePath (), swz_size >> 10);
+}
+
+/*
+=================
+Mod_LoadMapCache
+
+Returns false if there is no usable cache for mod, in which case it must be
+loaded from the bsp as usual
+=================
+*/
+qboolean Mod_LoadMapCache (model_t *mod)
+{
+	static mapcache_t	cache;
+	static model_t		original;
+	int			sizes[8];
+	int			h, len, bsplen, crc, mark, i;
+	texture_t	*tx;
+
+	if (!mod_mapcache.value)
+		return false;
+	if (strcmp (COM_FileExtension (mod->name), "bsp"))
+		return false;
+
+	COM_FileBase (mod->name, loadname, 32);
+
+	len = Sys_FileOpenRead (Mod_MapCachePath (), &h);
+	if (h == -1)
+		return false;
+	Sys_FileReadAhead (h, len);
+
+	Mod_MapCacheSizes (sizes);
+	if (len < sizeof(cache)
+	|| Sys_FileRead (h, &cache, sizeof(cache)) != sizeof(cache)
+	|| cache.ident != MAPCACHE_IDENT
+	|| cache.version != MAPCACHE_VERSION
+	|| memcmp (cache.sizes, sizes, sizeof(sizes))
+	|| cache.datasize <= 0
+	|| cache.datasize != len - sizeof(cache))
+	{
+		Con_DPrintf ("%s is stale\n", Mod_MapCachePath ());
+		Sys_FileClose (h);
+		return false;
+	}
+
+	crc = Mod_MapCacheFileCRC (mod->name, &bsplen);
+	if (crc == -1 || cache.bspsize != bsplen || cache.bspcrc != crc)
+	{
+		Con_DPrintf ("%s is stale\n", Mod_MapCachePath ());
+		Sys_FileClose (h);
+		return false;
+	}
+
+	loadmodel = mod;
+	original = *mod;
+	mark = Hunk_LowMark ();
+
+	swz_base = Hunk_AllocName (cache.datasize, loadname);
+	swz_size = cache.datasize;
+
+	Draw_BeginDisc ();
+	i = Sys_FileRead (h, swz_base, swz_size);
+	Sys_FileClose (h);
+	Draw_EndDisc ();
+
+	*mod = cache.model;
+	strcpy (mod->name, original.name);
+	mod->needload = NL_PRESENT;
+	mod->cache = original.cache;
+
+	swz_save = false;
+	swz_bad = false;
+	Mod_SwizzleModel (mod);
+	if (!swz_bad)
+		Mod_SwizzleData (mod);
+
+	if (i != swz_size || swz_bad)
+	{
+		Con_Printf ("%s is damaged\n", Mod_MapCachePath ());
+		Hunk_FreeToLowMark (mark);
+		*mod = original;
+		return false;
+	}
+
+// the sky is unpacked outside of the hunk
+	for (i=0 ; i<mod->numtextures ; i++)
+	{
+		tx = mod->textures[i];
+		if (tx && !Q_strncmp (tx->name, "sky", 3))
+			R_InitSky (tx);
+	}
+
+	Mod_SetupSubmodels (mod);
+
+	return true;
+}
+
 /*
 ==============================================================================
 
@@ -1420,6 +1879,238 @@ void * Mod_LoadAliasSkinGroup (void * pin, int *pskinindex, int skinsize,
 }
 
 
+/*
+==============================================================================
+
+ALIAS LEVELS OF DETAIL
+
+Simplified triangle lists are built once at load time by folding the shortest
+edges of the base frame into one of their ends.  The vertices themselves are
+kept, so every frame and skin still applies; only fewer triangles reference
+them.
+
+==============================================================================
+*/
+
+#define ALIAS_LOD_MINTRIS	32		// don't bother simplifying gibs and such
+
+#define ALIAS_FACES_FRONT	1
+#define ALIAS_FACES_BACK	2
+
+typedef struct
+{
+	int		from, to;
+	float	dist;
+} aliasfold_t;
+
+static int Mod_AliasFoldCompare (const void *a, const void *b)
+{
+	float	d;
+
+	d = ((aliasfold_t *)a)->dist - ((aliasfold_t *)b)->dist;
+	if (d < 0)
+		return -1;
+	return d > 0;
+}
+
+/*
+=================
+Mod_AliasCanFold
+
+A seam vertex can't be moved, and a vertex can't be moved onto one whose
+skin coordinates belong to the other half of the skin
+=================
+*/
+static qboolean Mod_AliasCanFold (int from, int to, stvert_t *pstverts,
+	byte *facing)
+{
+	if (pstverts[from].onseam)
+		return false;
+	return !(facing[from] & ~facing[to]);
+}
+
+/*
+=================
+Mod_AliasFoldPass
+
+Folds a batch of independent shortest edges, taking away at most about
+excess triangles; returns false if nothing could be folded
+=================
+*/
+static qboolean Mod_AliasFoldPass (mtriangle_t *tris, int *numtris,
+	int excess, trivertx_t *verts, mdl_t *pmodel, stvert_t *pstverts,
+	byte *facing, byte *touched, int *remap, aliasfold_t *folds)
+{
+	int			i, j, k, a, b, numfolds, folded;
+	float		d;
+	mtriangle_t	*ptri;
+
+	numfolds = 0;
+	for (i=0, ptri=tris ; i<*numtris ; i++, ptri++)
+	{
+		for (j=0 ; j<3 ; j++)
+		{
+			a = ptri->vertindex[j];
+			b = ptri->vertindex[j == 2 ? 0 : j+1];
+
+			if (Mod_AliasCanFold (a, b, pstverts, facing))
+			{
+				folds[numfolds].from = a;
+				folds[numfolds].to = b;
+			}
+			else if (Mod_AliasCanFold (b, a, pstverts, facing))
+			{
+				folds[numfolds].from = b;
+				folds[numfolds].to = a;
+			}
+			else
+				continue;
+
+			folds[numfolds].dist = 0;
+			for (k=0 ; k<3 ; k++)
+			{
+				d = (verts[a].v[k] - verts[b].v[k]) * pmodel->scale[k];
+				folds[numfolds].dist += d * d;
+			}
+			numfolds++;
+		}
+	}
+
+	if (!numfolds)
+		return false;
+
+	qsort (folds, numfolds, sizeof(folds[0]), Mod_AliasFoldCompare);
+
+// an edge inside the mesh takes two triangles with it
+	memset (touched, 0, pmodel->numverts);
+	folded = 0;
+
+	for (i=0 ; i<numfolds && folded*2 < excess ; i++)
+	{
+		a = folds[i].from;
+		b = folds[i].to;
+		if (touched[a] || touched[b])
+			continue;
+
+		touched[a] = touched[b] = 1;
+		remap[a] = b;
+		facing[b] |= facing[a];
+		folded++;
+	}
+
+	if (!folded)
+		return false;
+
+// remap, dropping the triangles that collapsed to an edge
+	for (i=0 ; i<*numtris ; )
+	{
+		ptri = &tris[i];
+		for (j=0 ; j<3 ; j++)
+			ptri->vertindex[j] = remap[ptri->vertindex[j]];
+
+		if (ptri->vertindex[0] == ptri->vertindex[1] ||
+			ptri->vertindex[1] == ptri->vertindex[2] ||
+			ptri->vertindex[2] == ptri->vertindex[0])
+		{
+			*ptri = tris[--*numtris];
+			continue;
+		}
+		i++;
+	}
+
+	return true;
+}
+
+/*
+=================
+Mod_MakeAliasLODs
+
+Builds the reduced triangle lists on the hunk after the rest of the model, so
+they move to the cache with it.  Levels that can't be made noticeably smaller
+are left out.
+=================
+*/
+void Mod_MakeAliasLODs (aliashdr_t *pheader, mdl_t *pmodel, mtriangle_t *ptri,
+	stvert_t *pstverts)
+{
+	int			i, j, lod, numtris, target;
+	trivertx_t	*verts;
+	maliasgroup_t	*paliasgroup;
+	mtriangle_t	*tris, *out;
+	aliasfold_t	*folds;
+	byte		*facing, *touched;
+	int			*remap;
+
+	memset (pheader->lodtriangles, 0, sizeof(pheader->lodtriangles));
+	memset (pheader->lodnumtris, 0, sizeof(pheader->lodnumtris));
+	pheader->lodtriangles[0] = pheader->triangles;
+	pheader->lodnumtris[0] = pmodel->numtris;
+
+	if (pmodel->numtris < ALIAS_LOD_MINTRIS)
+		return;
+
+// measure edges in the first pose
+	if (pheader->frames[0].type == ALIAS_SINGLE)
+	{
+		verts = (trivertx_t *)((byte *)pheader + pheader->frames[0].frame);
+	}
+	else
+	{
+		paliasgroup = (maliasgroup_t *)((byte *)pheader +
+				pheader->frames[0].frame);
+		verts = (trivertx_t *)((byte *)pheader + paliasgroup->frames[0].frame);
+	}
+
+	tris = malloc (pmodel->numtris * sizeof(*tris));
+	folds = malloc (pmodel->numtris * 3 * sizeof(*folds));
+	remap = malloc (pmodel->numverts * sizeof(*remap));
+	facing = calloc (pmodel->numverts, 1);
+	touched = malloc (pmodel->numverts);
+
+	if (tris && folds && remap && facing && touched)
+	{
+		memcpy (tris, ptri, pmodel->numtris * sizeof(*tris));
+		numtris = pmodel->numtris;
+
+		for (i=0 ; i<pmodel->numverts ; i++)
+			remap[i] = i;
+
+		for (i=0 ; i<numtris ; i++)
+		{
+			for (j=0 ; j<3 ; j++)
+			{
+				facing[tris[i].vertindex[j]] |= tris[i].facesfront ?
+						ALIAS_FACES_FRONT : ALIAS_FACES_BACK;
+			}
+		}
+
+		for (lod=1 ; lod<ALIAS_LODS ; lod++)
+		{
+			target = pmodel->numtris >> lod;
+
+			while (numtris > target &&
+				   Mod_AliasFoldPass (tris, &numtris, numtris - target, verts,
+					   pmodel, pstverts, facing, touched, remap, folds))
+				;
+
+			if (numtris > pheader->lodnumtris[lod-1] * 7 / 8)
+				break;
+
+			out = Hunk_AllocName (numtris * sizeof(*out), loadname);
+			memcpy (out, tris, numtris * sizeof(*out));
+			pheader->lodtriangles[lod] = (byte *)out - (byte *)pheader;
+			pheader->lodnumtris[lod] = numtris;
+		}
+	}
+
+	free (tris);
+	free (folds);
+	free (remap);
+	free (facing);
+	free (touched);
+}
+
+
 /*
 =================
 Mod_LoadAliasModel
@@ -1625,6 +2316,8 @@ void Mod_LoadAliasModel (model_t *mod, void *buffer)
 		}
 	}
 
+	Mod_MakeAliasLODs (pheader, pmodel, ptri, pstverts);
+
 	mod->type = mod_alias;
 
 // FIXME: do this right
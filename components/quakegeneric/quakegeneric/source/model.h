@@ -272,11 +272,15 @@ typedef struct mtriangle_s {
 	int					vertindex[3];
 } mtriangle_t;
 
+#define	ALIAS_LODS		3		// full detail plus two simplified levels
+
 typedef struct {
 	int					model;
 	int					stverts;
 	int					skindesc;
 	int					triangles;
+	int					lodtriangles[ALIAS_LODS];	// level 0 == triangles
+	int					lodnumtris[ALIAS_LODS];		// 0 if not built
 	maliasframedesc_t	frames[1];
 } aliashdr_t;
 
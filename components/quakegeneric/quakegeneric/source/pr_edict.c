@@ -1015,7 +1015,10 @@ void PR_LoadProgs (void)
 	pr_fielddefs = (ddef_t *)((byte *)progs + progs->ofs_fielddefs);
 	pr_statements = (dstatement_t *)((byte *)progs + progs->ofs_statements);
 
-	pr_global_struct = (globalvars_t *)((byte *)progs + progs->ofs_globals);
+// the globals are read and written by nearly every statement, so they get a
+// placed copy of their own instead of staying in the middle of the file
+	pr_global_struct = Hunk_PlacedAlloc (progs->numglobals * 4, "globals");
+	memcpy (pr_global_struct, (byte *)progs + progs->ofs_globals, progs->numglobals * 4);
 	pr_globals = (float *)pr_global_struct;
 	
 	pr_edict_size = progs->entityfields * 4 + sizeof (edict_t) - sizeof(entvars_t);
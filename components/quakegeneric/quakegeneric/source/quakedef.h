@@ -242,6 +242,8 @@ typedef struct
 	char	**argv;
 	void	*membase;
 	int		memsize;
+	void	*fastmembase;	// optional small block of fast memory
+	int		fastmemsize;
 } quakeparms_t;
 
 
@@ -20,6 +20,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#endif
+
+#define FASTMEM_SIZE	(256*1024)	// default, override with -fastmem <kb>
+
 void QG_Tick(double duration)
 {
 	Host_Frame(duration);
@@ -29,12 +35,30 @@ void QG_Create(int argc, char *argv[])
 {
 	static quakeparms_t    parms;
 
+	int p;
+
 	parms.memsize = 20*1024*1024;
 	parms.membase = malloc (parms.memsize);
 	parms.basedir = ".";
 
 	COM_InitArgv (argc, argv);
 
+	// fast memory for the placement table; halve until it fits
+	parms.fastmemsize = FASTMEM_SIZE;
+	p = COM_CheckParm ("-fastmem");
+	if (p && p < com_argc-1)
+		parms.fastmemsize = Q_atoi (com_argv[p+1]) * 1024;
+	for ( ; parms.fastmemsize >= 16*1024 ; parms.fastmemsize >>= 1)
+	{
+#ifdef ESP_PLATFORM
+		parms.fastmembase = heap_caps_malloc (parms.fastmemsize, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+		parms.fastmembase = malloc (parms.fastmemsize);
+#endif
+		if (parms.fastmembase)
+			break;
+	}
+
 	parms.argc = com_argc;
 	parms.argv = com_argv;
 
@@ -53,6 +53,7 @@ void QG_Init(void);
 void QG_Quit(void);
 void QG_DrawFrame(void *pixels);
 void QG_SetPalette(unsigned char palette[768]);
+void QG_SetPalette565(unsigned short palette[256]);	// if VID_PALETTE565
 int QG_GetKey(int *down, int *key);
 void QG_GetMouseMove(int *x, int *y);
 void QG_GetJoyAxes(float *axes);
@@ -18,7 +18,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
-#include "quakegeneric.h"
+// quakegeneric_null.c: headless runner with no video, input or sound
+//
+// Runs host frames as fast as it can.  Once a timedemo given on the command
+// line has finished it quits, so renderer builds can be timed against each
+// other with something like
+//
+//	quakegeneric_null +timedemo demo1
+
+#include "quakedef.h"
+
+static qboolean	qg_sawtimedemo;
 
 void QG_Init(void)
 {
@@ -30,9 +40,19 @@ int QG_GetKey(int *down, int *key)
 	return 0;
 }
 
-void QG_Quit(void)
+void QG_GetMouseMove(int *x, int *y)
 {
+	*x = *y = 0;
+}
 
+void QG_GetJoyAxes(float *axes)
+{
+	memset(axes, 0, QUAKEGENERIC_JOY_MAX_AXES * sizeof(float));
+}
+
+void QG_Quit(void)
+{
+	exit(0);
 }
 
 void QG_DrawFrame(void *pixels)
@@ -45,7 +65,30 @@ void QG_SetPalette(unsigned char palette[768])
 
 }
 
+void QG_SetPalette565(unsigned short palette[256])
+{
+
+}
+
 int main(int argc, char *argv[])
 {
+	double oldtime, newtime;
+
+	QG_Create(argc, argv);
+
+	oldtime = Sys_FloatTime() - 0.1;
+	while (1)
+	{
+		newtime = Sys_FloatTime();
+		QG_Tick(newtime - oldtime);
+		oldtime = newtime;
+
+		// the timedemo prints its result when it stops
+		if (cls.timedemo)
+			qg_sawtimedemo = true;
+		else if (qg_sawtimedemo)
+			Sys_Quit();
+	}
+
 	return 0;
 }
@@ -55,6 +55,52 @@ int				r_anumverts;
 
 float	aliastransform[3][4];
 
+float	r_aliasscreenmins[2], r_aliasscreenmaxs[2];	// projected bbox of the
+													//  last R_AliasCheckBBox
+
+// the transformed vertices of the current model, one array per axis
+static float	r_avertx[MAXALIASVERTS];
+static float	r_averty[MAXALIASVERTS];
+static float	r_avertz[MAXALIASVERTS];
+
+// memoised finalverts: a model drawn again with the same vertices, transform,
+// projection and lighting (a static view, or the same entity in each band of
+// a tiled frame) reuses the finalverts of the last draw instead of redoing them
+#define ALIAS_MEMO_SLOTS	32
+#define ALIAS_MEMO_POOL		(160*1024)
+
+typedef struct
+{
+	trivertx_t	*verts;
+	int			numverts;
+	int			trivial_accept;
+	float		transform[3][4];
+	float		xscale, yscale, xcenter, ycenter, ziscale;
+	int			vrect[4];
+	int			ambientlight;
+	float		shadelight;
+	vec3_t		lightvec;
+} aliasmemokey_t;
+
+typedef struct
+{
+	aliasmemokey_t	key;
+	int				offset, size;	// in r_amemopool, size 0 = empty
+} aliasmemo_t;
+
+static aliasmemo_t	r_amemo[ALIAS_MEMO_SLOTS];
+static byte			*r_amemopool;
+static int			r_amemonext, r_amemoslot;
+static qboolean		r_amemohit;		// finalverts are already computed
+
+int				r_amodels_memoised;
+
+// triangle list for the level of detail chosen for the model being drawn
+static mtriangle_t	*r_alodtris;
+static int			r_alodnumtris;
+
+int				r_amodels_reduced, r_atris_drawn;
+
 typedef struct {
 	int	index0;
 	int	index1;
@@ -72,12 +118,8 @@ float	r_avertexnormals[NUMVERTEXNORMALS][3] = {
 #include "anorms.h"
 };
 
-void R_AliasTransformAndProjectFinalVerts (finalvert_t *fv,
-	stvert_t *pstverts);
 void R_AliasSetUpTransform (int trivial_accept);
 void R_AliasTransformVector (vec3_t in, vec3_t out);
-void R_AliasTransformFinalVert (finalvert_t *fv, auxvert_t *av,
-	trivertx_t *pverts, stvert_t *pstverts);
 void R_AliasProjectFinalVert (finalvert_t *fv, auxvert_t *av);
 
 
@@ -200,6 +242,9 @@ qboolean R_AliasCheckBBox (void)
 	anyclip = 0;
 	allclip = ALIAS_XY_CLIP_MASK;
 
+	r_aliasscreenmins[0] = r_aliasscreenmins[1] = 999999;
+	r_aliasscreenmaxs[0] = r_aliasscreenmaxs[1] = -999999;
+
 // TODO: probably should do this loop in ASM, especially if we use floats
 	for (i=0 ; i<numv ; i++)
 	{
@@ -213,6 +258,15 @@ qboolean R_AliasCheckBBox (void)
 		v0 = (viewaux[i].fv[0] * xscale * zi) + xcenter;
 		v1 = (viewaux[i].fv[1] * yscale * zi) + ycenter;
 
+		if (v0 < r_aliasscreenmins[0])
+			r_aliasscreenmins[0] = v0;
+		if (v0 > r_aliasscreenmaxs[0])
+			r_aliasscreenmaxs[0] = v0;
+		if (v1 < r_aliasscreenmins[1])
+			r_aliasscreenmins[1] = v1;
+		if (v1 > r_aliasscreenmaxs[1])
+			r_aliasscreenmaxs[1] = v1;
+
 		flags = 0;
 
 		if (v0 < r_refdef.fvrectx)
@@ -258,6 +312,180 @@ void R_AliasTransformVector (vec3_t in, vec3_t out)
 }
 
 
+/*
+================
+R_AliasTransformVerts
+
+Runs all of r_apverts through aliastransform into r_avert[xyz]
+================
+*/
+void R_AliasTransformVerts (void)
+{
+	int			i;
+	trivertx_t	*pverts;
+
+	pverts = r_apverts;
+
+	for (i=0 ; i<r_anumverts ; i++, pverts++)
+	{
+		r_avertx[i] = DotProduct(pverts->v, aliastransform[0]) +
+				aliastransform[0][3];
+		r_averty[i] = DotProduct(pverts->v, aliastransform[1]) +
+				aliastransform[1][3];
+		r_avertz[i] = DotProduct(pverts->v, aliastransform[2]) +
+				aliastransform[2][3];
+	}
+}
+
+
+/*
+================
+R_AliasLightVerts
+
+Texture coordinates, seam flags and lighting of every finalvert
+================
+*/
+void R_AliasLightVerts (finalvert_t *fv, stvert_t *pstverts)
+{
+	int			i, temp;
+	float		lightcos, *plightnormal;
+	trivertx_t	*pverts;
+
+	pverts = r_apverts;
+
+	for (i=0 ; i<r_anumverts ; i++, fv++, pverts++, pstverts++)
+	{
+		fv->v[2] = pstverts->s;
+		fv->v[3] = pstverts->t;
+		fv->flags = pstverts->onseam;
+
+		plightnormal = r_avertexnormals[pverts->lightnormalindex];
+		lightcos = DotProduct (plightnormal, r_plightvec);
+		temp = r_ambientlight;
+
+		if (lightcos < 0)
+		{
+			temp += (int)(r_shadelight * lightcos);
+
+		// clamp; because we limited the minimum ambient and shading light, we
+		// don't have to clamp low light, just bright
+			if (temp < 0)
+				temp = 0;
+		}
+
+		fv->v[4] = temp;
+	}
+}
+
+
+/*
+================
+R_AliasMemoFind
+
+Points pfinalverts and pauxverts at the memo for the model about to be drawn,
+setting r_amemohit if they already hold its vertices.  Leaves them alone if
+memoising is off or the model doesn't fit.
+================
+*/
+void R_AliasMemoFind (void)
+{
+	aliasmemokey_t	key;
+	aliasmemo_t		*memo;
+	int				i, size, fvsize;
+
+	r_amemohit = false;
+
+	if (!r_aliasmemo.value)
+		return;
+
+	if (!r_amemopool)
+	{
+		r_amemopool = malloc (ALIAS_MEMO_POOL);
+		if (!r_amemopool)
+		{
+			Cvar_SetValue ("r_aliasmemo", 0);
+			return;
+		}
+	}
+
+	fvsize = (r_anumverts * sizeof(finalvert_t) + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1);
+	size = fvsize;
+	if (!currententity->trivial_accept)
+		size += r_anumverts * sizeof(auxvert_t);
+	size = (size + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1);
+	if (size > ALIAS_MEMO_POOL)
+		return;
+
+	memset (&key, 0, sizeof(key));
+	key.verts = r_apverts;
+	key.numverts = r_anumverts;
+	key.trivial_accept = currententity->trivial_accept;
+	memcpy (key.transform, aliastransform, sizeof(key.transform));
+	key.xscale = aliasxscale;
+	key.yscale = aliasyscale;
+	key.xcenter = aliasxcenter;
+	key.ycenter = aliasycenter;
+	key.ziscale = ziscale;
+	key.vrect[0] = r_refdef.aliasvrect.x;
+	key.vrect[1] = r_refdef.aliasvrect.y;
+	key.vrect[2] = r_refdef.aliasvrectright;
+	key.vrect[3] = r_refdef.aliasvrectbottom;
+	key.ambientlight = r_ambientlight;
+	key.shadelight = r_shadelight;
+	VectorCopy (r_plightvec, key.lightvec);
+
+	for (i=0, memo=r_amemo ; i<ALIAS_MEMO_SLOTS ; i++, memo++)
+	{
+		if (memo->size && !memcmp (&memo->key, &key, sizeof(key)))
+		{
+			r_amemohit = true;
+			r_amodels_memoised++;
+			break;
+		}
+	}
+
+	if (!r_amemohit)
+	{
+	// take the next stretch of the pool, dropping any memos it overlaps
+		if (r_amemonext + size > ALIAS_MEMO_POOL)
+			r_amemonext = 0;
+
+		for (i=0, memo=r_amemo ; i<ALIAS_MEMO_SLOTS ; i++, memo++)
+		{
+			if (memo->size && memo->offset < r_amemonext + size &&
+				memo->offset + memo->size > r_amemonext)
+				memo->size = 0;
+		}
+
+		memo = &r_amemo[r_amemoslot];
+		r_amemoslot = (r_amemoslot + 1) % ALIAS_MEMO_SLOTS;
+
+		memo->key = key;
+		memo->offset = r_amemonext;
+		memo->size = size;
+		r_amemonext += size;
+	}
+
+	pfinalverts = (finalvert_t *)(r_amemopool + memo->offset);
+	pauxverts = (auxvert_t *)(r_amemopool + memo->offset + fvsize);
+}
+
+
+/*
+================
+R_AliasClearMemo
+
+Alias models may be reloaded elsewhere, so memos don't outlive a level
+================
+*/
+void R_AliasClearMemo (void)
+{
+	memset (r_amemo, 0, sizeof(r_amemo));
+	r_amemonext = 0;
+	r_amemoslot = 0;
+}
+
+
 /*
 ================
 R_AliasPreparePoints
@@ -274,28 +502,38 @@ void R_AliasPreparePoints (void)
 	mtriangle_t	*ptri;
 	finalvert_t	*pfv[3];
 
-	pstverts = (stvert_t *)((byte *)paliashdr + paliashdr->stverts);
-	r_anumverts = pmdl->numverts;
- 	fv = pfinalverts;
-	av = pauxverts;
-
-	for (i=0 ; i<r_anumverts ; i++, fv++, av++, r_apverts++, pstverts++)
+	if (!r_amemohit)
 	{
-		R_AliasTransformFinalVert (fv, av, r_apverts, pstverts);
-		if (av->fv[2] < ALIAS_Z_CLIP_PLANE)
-			fv->flags |= ALIAS_Z_CLIP;
-		else
+		pstverts = (stvert_t *)((byte *)paliashdr + paliashdr->stverts);
+
+		R_AliasTransformVerts ();
+		R_AliasLightVerts (pfinalverts, pstverts);
+
+	// clip flags and projection
+		fv = pfinalverts;
+		av = pauxverts;
+
+		for (i=0 ; i<r_anumverts ; i++, fv++, av++)
 		{
-			 R_AliasProjectFinalVert (fv, av);
-
-			if (fv->v[0] < r_refdef.aliasvrect.x)
-				fv->flags |= ALIAS_LEFT_CLIP;
-			if (fv->v[1] < r_refdef.aliasvrect.y)
-				fv->flags |= ALIAS_TOP_CLIP;
-			if (fv->v[0] > r_refdef.aliasvrectright)
-				fv->flags |= ALIAS_RIGHT_CLIP;
-			if (fv->v[1] > r_refdef.aliasvrectbottom)
-				fv->flags |= ALIAS_BOTTOM_CLIP;	
+			av->fv[0] = r_avertx[i];
+			av->fv[1] = r_averty[i];
+			av->fv[2] = r_avertz[i];
+
+			if (av->fv[2] < ALIAS_Z_CLIP_PLANE)
+				fv->flags |= ALIAS_Z_CLIP;
+			else
+			{
+				R_AliasProjectFinalVert (fv, av);
+
+				if (fv->v[0] < r_refdef.aliasvrect.x)
+					fv->flags |= ALIAS_LEFT_CLIP;
+				if (fv->v[1] < r_refdef.aliasvrect.y)
+					fv->flags |= ALIAS_TOP_CLIP;
+				if (fv->v[0] > r_refdef.aliasvrectright)
+					fv->flags |= ALIAS_RIGHT_CLIP;
+				if (fv->v[1] > r_refdef.aliasvrectbottom)
+					fv->flags |= ALIAS_BOTTOM_CLIP;	
+			}
 		}
 	}
 
@@ -304,8 +542,8 @@ void R_AliasPreparePoints (void)
 //
 	r_affinetridesc.numtriangles = 1;
 
-	ptri = (mtriangle_t *)((byte *)paliashdr + paliashdr->triangles);
-	for (i=0 ; i<pmdl->numtris ; i++, ptri++)
+	ptri = r_alodtris;
+	for (i=0 ; i<r_alodnumtris ; i++, ptri++)
 	{
 		pfv[0] = &pfinalverts[ptri->vertindex[0]];
 		pfv[1] = &pfinalverts[ptri->vertindex[1]];
@@ -409,94 +647,28 @@ void R_AliasSetUpTransform (int trivial_accept)
 
 /*
 ================
-R_AliasTransformFinalVert
-================
-*/
-void R_AliasTransformFinalVert (finalvert_t *fv, auxvert_t *av,
-	trivertx_t *pverts, stvert_t *pstverts)
-{
-	int		temp;
-	float	lightcos, *plightnormal;
-
-	av->fv[0] = DotProduct(pverts->v, aliastransform[0]) +
-			aliastransform[0][3];
-	av->fv[1] = DotProduct(pverts->v, aliastransform[1]) +
-			aliastransform[1][3];
-	av->fv[2] = DotProduct(pverts->v, aliastransform[2]) +
-			aliastransform[2][3];
-
-	fv->v[2] = pstverts->s;
-	fv->v[3] = pstverts->t;
-
-	fv->flags = pstverts->onseam;
-
-// lighting
-	plightnormal = r_avertexnormals[pverts->lightnormalindex];
-	lightcos = DotProduct (plightnormal, r_plightvec);
-	temp = r_ambientlight;
-
-	if (lightcos < 0)
-	{
-		temp += (int)(r_shadelight * lightcos);
-
-	// clamp; because we limited the minimum ambient and shading light, we
-	// don't have to clamp low light, just bright
-		if (temp < 0)
-			temp = 0;
-	}
+R_AliasProjectVerts
 
-	fv->v[4] = temp;
-}
-
-/*
-================
-R_AliasTransformAndProjectFinalVerts
+Projects r_avert[xyz] for the unclipped case, where aliastransform already
+includes the screen scale
 ================
 */
-void R_AliasTransformAndProjectFinalVerts (finalvert_t *fv, stvert_t *pstverts)
+void R_AliasProjectVerts (finalvert_t *fv)
 {
-	int			i, temp;
-	float		lightcos, *plightnormal, zi;
-	trivertx_t	*pverts;
-
-	pverts = r_apverts;
+	int			i;
+	float		zi;
 
-	for (i=0 ; i<r_anumverts ; i++, fv++, pverts++, pstverts++)
+	for (i=0 ; i<r_anumverts ; i++, fv++)
 	{
-	// transform and project
-		zi = 1.0 / (DotProduct(pverts->v, aliastransform[2]) +
-				aliastransform[2][3]);
+		zi = 1.0 / r_avertz[i];
 
 	// x, y, and z are scaled down by 1/2**31 in the transform, so 1/z is
 	// scaled up by 1/2**31, and the scaling cancels out for x and y in the
 	// projection
 		fv->v[5] = zi;
 
-		fv->v[0] = ((DotProduct(pverts->v, aliastransform[0]) +
-				aliastransform[0][3]) * zi) + aliasxcenter;
-		fv->v[1] = ((DotProduct(pverts->v, aliastransform[1]) +
-				aliastransform[1][3]) * zi) + aliasycenter;
-
-		fv->v[2] = pstverts->s;
-		fv->v[3] = pstverts->t;
-		fv->flags = pstverts->onseam;
-
-	// lighting
-		plightnormal = r_avertexnormals[pverts->lightnormalindex];
-		lightcos = DotProduct (plightnormal, r_plightvec);
-		temp = r_ambientlight;
-
-		if (lightcos < 0)
-		{
-			temp += (int)(r_shadelight * lightcos);
-
-		// clamp; because we limited the minimum ambient and shading light, we
-		// don't have to clamp low light, just bright
-			if (temp < 0)
-				temp = 0;
-		}
-
-		fv->v[4] = temp;
+		fv->v[0] = (r_avertx[i] * zi) + aliasxcenter;
+		fv->v[1] = (r_averty[i] * zi) + aliasycenter;
 	}
 }
 
@@ -529,20 +701,23 @@ void R_AliasPrepareUnclippedPoints (void)
 	stvert_t	*pstverts;
 	finalvert_t	*fv;
 
-	pstverts = (stvert_t *)((byte *)paliashdr + paliashdr->stverts);
-	r_anumverts = pmdl->numverts;
-// FIXME: just use pfinalverts directly?
 	fv = pfinalverts;
 
-	R_AliasTransformAndProjectFinalVerts (fv, pstverts);
+	if (!r_amemohit)
+	{
+		pstverts = (stvert_t *)((byte *)paliashdr + paliashdr->stverts);
+
+		R_AliasTransformVerts ();
+		R_AliasLightVerts (fv, pstverts);
+		R_AliasProjectVerts (fv);
+	}
 
 	if (r_affinetridesc.drawtype)
 		D_PolysetDrawFinalVerts (fv, r_anumverts);
 
 	r_affinetridesc.pfinalverts = pfinalverts;
-	r_affinetridesc.ptriangles = (mtriangle_t *)
-			((byte *)paliashdr + paliashdr->triangles);
-	r_affinetridesc.numtriangles = pmdl->numtris;
+	r_affinetridesc.ptriangles = r_alodtris;
+	r_affinetridesc.numtriangles = r_alodnumtris;
 
 	D_PolysetDraw ();
 }
@@ -689,6 +864,47 @@ void R_AliasSetupFrame (void)
 }
 
 
+/*
+================
+R_AliasSetupLOD
+
+Picks the coarsest triangle list the projected size of the model allows.
+Relies on R_AliasCheckBBox having just been run for the entity; the view
+model is always drawn in full.
+================
+*/
+void R_AliasSetupLOD (void)
+{
+	int		lod;
+	float	size;
+
+	lod = 0;
+
+	if (r_aliaslod.value && currententity != &cl.viewent)
+	{
+		size = r_aliasscreenmaxs[0] - r_aliasscreenmins[0];
+		if (size < r_aliasscreenmaxs[1] - r_aliasscreenmins[1])
+			size = r_aliasscreenmaxs[1] - r_aliasscreenmins[1];
+
+		if (size < r_aliaslod1.value)
+			lod = 1;
+		if (size < r_aliaslod2.value)
+			lod = 2;
+
+		while (lod && !paliashdr->lodnumtris[lod])
+			lod--;
+	}
+
+	if (lod)
+		r_amodels_reduced++;
+
+	r_alodtris = (mtriangle_t *)((byte *)paliashdr +
+			paliashdr->lodtriangles[lod]);
+	r_alodnumtris = paliashdr->lodnumtris[lod];
+	r_atris_drawn += r_alodnumtris;
+}
+
+
 /*
 ================
 R_AliasDrawModel
@@ -714,6 +930,7 @@ void R_AliasDrawModel (alight_t *plighting)
 	R_AliasSetUpTransform (currententity->trivial_accept);
 	R_AliasSetupLighting (plighting);
 	R_AliasSetupFrame ();
+	R_AliasSetupLOD ();
 
 	if (!currententity->colormap)
 		Sys_Error ("R_AliasDrawModel: !currententity->colormap");
@@ -733,6 +950,9 @@ void R_AliasDrawModel (alight_t *plighting)
 	else
 		ziscale = (float)0x8000 * (float)0x10000 * 3.0;
 
+	r_anumverts = pmdl->numverts;
+	R_AliasMemoFind ();
+
 	if (currententity->trivial_accept)
 		R_AliasPrepareUnclippedPoints ();
 	else
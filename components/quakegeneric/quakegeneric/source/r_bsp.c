@@ -39,6 +39,8 @@ vec3_t			r_worldmodelorg;
 
 int				r_currentbkey;
 
+int				r_bmodelpolys;	// front facing bmodel polys this frame
+
 typedef enum {touchessolid, drawnode, nodrawnode} solidstate_t;
 
 #define MAX_BMODEL_VERTS	500			// 6K
@@ -362,6 +364,7 @@ void R_DrawSolidClippedSubmodelPolygons (model_t *pmodel)
 			pbverts = bverts;
 			pbedges = bedges;
 			numbverts = numbedges = 0;
+			r_bmodelpolys++;
 
 			if (psurf->numedges > 0)
 			{
@@ -432,6 +435,7 @@ void R_DrawSubmodelPolygons (model_t *pmodel, int clipflags)
 			(!(psurf->flags & SURF_PLANEBACK) && (dot > BACKFACE_EPSILON)))
 		{
 			r_currentkey = ((mleaf_t *)currententity->topnode)->key;
+			r_bmodelpolys++;
 
 		// FIXME: use bounding-box-based frustum clipping info?
 			R_RenderFace (psurf, clipflags);
@@ -440,6 +444,58 @@ void R_DrawSubmodelPolygons (model_t *pmodel, int clipflags)
 }
 
 
+/*
+================
+R_DrawNodeSurfaces
+
+Emits the surfaces on a node that face the viewer and were marked by a leaf
+this frame; dot is the viewer's distance from the node plane
+================
+*/
+static void R_DrawNodeSurfaces (msurface_t *surf, int c, double dot, int clipflags)
+{
+	int		planeback;
+
+	if (dot < -BACKFACE_EPSILON)
+		planeback = SURF_PLANEBACK;
+	else if (dot > BACKFACE_EPSILON)
+		planeback = 0;
+	else
+		return;
+
+	do
+	{
+		if (((surf->flags & SURF_PLANEBACK) == planeback) &&
+			(surf->visframe == r_framecount))
+		{
+			if (r_drawpolys)
+			{
+				if (r_worldpolysbacktofront)
+				{
+					if (numbtofpolys < MAX_BTOFPOLYS)
+					{
+						pbtofpolys[numbtofpolys].clipflags =
+								clipflags;
+						pbtofpolys[numbtofpolys].psurf = surf;
+						numbtofpolys++;
+					}
+				}
+				else
+				{
+					R_RenderPoly (surf, clipflags);
+				}
+			}
+			else
+			{
+				R_RenderFace (surf, clipflags);
+			}
+		}
+
+		surf++;
+	} while (--c);
+}
+
+
 /*
 ================
 R_RecursiveWorldNode
@@ -450,7 +506,7 @@ void R_RecursiveWorldNode (mnode_t *node, int clipflags)
 	int			i, c, side, *pindex;
 	vec3_t		acceptpt, rejectpt;
 	mplane_t	*plane;
-	msurface_t	*surf, **mark;
+	msurface_t	**mark;
 	mleaf_t		*pleaf;
 	double		d, dot;
 
@@ -560,84 +616,314 @@ void R_RecursiveWorldNode (mnode_t *node, int clipflags)
 
 		if (c)
 		{
-			surf = cl.worldmodel->surfaces + node->firstsurface;
+			R_DrawNodeSurfaces (cl.worldmodel->surfaces + node->firstsurface, c,
+					dot, clipflags);
 
-			if (dot < -BACKFACE_EPSILON)
-			{
-				do
-				{
-					if ((surf->flags & SURF_PLANEBACK) &&
-						(surf->visframe == r_framecount))
-					{
-						if (r_drawpolys)
-						{
-							if (r_worldpolysbacktofront)
-							{
-								if (numbtofpolys < MAX_BTOFPOLYS)
-								{
-									pbtofpolys[numbtofpolys].clipflags =
-											clipflags;
-									pbtofpolys[numbtofpolys].psurf = surf;
-									numbtofpolys++;
-								}
-							}
-							else
-							{
-								R_RenderPoly (surf, clipflags);
-							}
-						}
-						else
-						{
-							R_RenderFace (surf, clipflags);
-						}
-					}
+		// all surfaces on the same node share the same sequence number
+			r_currentkey++;
+		}
+
+	// recurse down the back side
+		R_RecursiveWorldNode (node->children[!side], clipflags);
+	}
+}
+
+
+
+/*
+===============================================================================
+
+VISIBLE NODE CACHE
+
+The PVS only changes when the viewer crosses into another leaf, so with
+r_worldcache set the nodes it leaves visible are copied out once per
+r_visframecount into a compact tree, and the world is walked through that
+instead of the whole BSP. Invisible and solid subtrees aren't in it at all,
+and a node without surfaces that has only one visible child is folded into
+that child: its box holds the child's, so culling the child instead loses
+nothing, and such a node takes no key.
+
+The frustum tests are done on integers: the clip plane normals are scaled
+by 8192 and compared against the node's short box corners, and a box is
+only rejected or accepted when it is clear of the plane by more than the
+rounding can account for. Anything closer keeps its clip flag and is
+clipped as usual. A node that was wholly inside a plane last frame is
+tested for that first, so a subtree that stays on screen costs one test
+per plane.
+
+===============================================================================
+*/
+
+#define VN_NORMALSCALE	8192
+#define VN_MARGIN		(8 * VN_NORMALSCALE)	// rounding the normals is worth
+												// at most 3 * 32768 / 16384 units
 
-					surf++;
-				} while (--c);
+typedef struct vnode_s
+{
+	short			minmaxs[6];
+	int				numsurfaces;	// -1 for a leaf
+	byte			accepted;		// planes it was wholly inside last time
+	mplane_t		*plane;
+	struct vnode_s	*children[2];	// NULL when nothing there is visible
+	msurface_t		*firstsurface;
+	mleaf_t			*leaf;
+} vnode_t;
+
+static vnode_t	*r_vnodes;
+static int		r_numvnodes, r_maxvnodes;
+static vnode_t	*r_vnoderoot;
+static model_t	*r_vnodemodel;
+static int		r_vnodevisframe;
+
+static int		r_vnnormal[4][3];
+static int		r_vndist[4];
+
+/*
+================
+R_BuildVisNode
+================
+*/
+static vnode_t *R_BuildVisNode (mnode_t *node)
+{
+	vnode_t		*vn, *front, *back;
+	int			i;
+
+	if (node->contents == CONTENTS_SOLID)
+		return NULL;
+	if (node->visframe != r_visframecount)
+		return NULL;
+
+	if (node->contents < 0)
+	{
+		front = back = NULL;
+	}
+	else
+	{
+		front = R_BuildVisNode (node->children[0]);
+		back = R_BuildVisNode (node->children[1]);
+
+		if (!node->numsurfaces)
+		{
+			if (!front)
+				return back;
+			if (!back)
+				return front;
+		}
+	}
+
+	vn = &r_vnodes[r_numvnodes++];
+	for (i=0 ; i<6 ; i++)
+		vn->minmaxs[i] = node->minmaxs[i];
+	vn->accepted = 0;
+	vn->children[0] = front;
+	vn->children[1] = back;
+
+	if (node->contents < 0)
+	{
+		vn->numsurfaces = -1;
+		vn->leaf = (mleaf_t *)node;
+		vn->plane = NULL;
+		vn->firstsurface = NULL;
+	}
+	else
+	{
+		vn->numsurfaces = node->numsurfaces;
+		vn->leaf = NULL;
+		vn->plane = node->plane;
+		vn->firstsurface = cl.worldmodel->surfaces + node->firstsurface;
+	}
+
+	return vn;
+}
+
+/*
+================
+R_BuildVisNodes
+
+Returns false if there's no room for the tree
+================
+*/
+static qboolean R_BuildVisNodes (void)
+{
+	model_t	*world;
+
+	world = cl.worldmodel;
+
+	if (r_vnodemodel == world && r_vnodevisframe == r_visframecount)
+		return r_vnoderoot != NULL;
+
+	if (r_maxvnodes < world->numnodes + world->numleafs)
+	{
+		free (r_vnodes);
+		r_maxvnodes = world->numnodes + world->numleafs;
+		r_vnodes = malloc (r_maxvnodes * sizeof(vnode_t));
+		if (!r_vnodes)
+		{
+			r_maxvnodes = 0;
+			r_vnodemodel = NULL;
+			return false;
+		}
+	}
+
+	r_numvnodes = 0;
+	r_vnoderoot = R_BuildVisNode (world->nodes);
+	r_vnodemodel = world;
+	r_vnodevisframe = r_visframecount;
+
+	return r_vnoderoot != NULL;
+}
+
+/*
+================
+R_SetVisNodeFrustum
+================
+*/
+static void R_SetVisNodeFrustum (void)
+{
+	int		i, j;
+
+	for (i=0 ; i<4 ; i++)
+	{
+		for (j=0 ; j<3 ; j++)
+			r_vnnormal[i][j] = Q_rint (view_clipplanes[i].normal[j] *
+					VN_NORMALSCALE);
+		r_vndist[i] = Q_rint (view_clipplanes[i].dist * VN_NORMALSCALE);
+	}
+}
+
+/*
+================
+R_VisNodeCorner
+
+Scaled distance of one box corner from clip plane i
+================
+*/
+static int R_VisNodeCorner (vnode_t *vn, int i, int *pindex)
+{
+	return vn->minmaxs[pindex[0]] * r_vnnormal[i][0] +
+			vn->minmaxs[pindex[1]] * r_vnnormal[i][1] +
+			vn->minmaxs[pindex[2]] * r_vnnormal[i][2] - r_vndist[i];
+}
+
+/*
+================
+R_RecursiveVisNode
+================
+*/
+static void R_RecursiveVisNode (vnode_t *vn, int clipflags)
+{
+	int			i, c, side, *pindex;
+	int			accepted;
+	mplane_t	*plane;
+	msurface_t	**mark;
+	mleaf_t		*pleaf;
+	double		dot;
+
+// cull the clipping planes if not trivial accept
+	if (clipflags)
+	{
+		accepted = 0;
+
+		for (i=0 ; i<4 ; i++)
+		{
+			if (! (clipflags & (1<<i)) )
+				continue;	// don't need to clip against it
+
+			pindex = pfrustum_indexes[i];
+
+		// still wholly inside, as it was last time?
+			if ((vn->accepted & (1<<i)) &&
+				((R_VisNodeCorner (vn, i, pindex + 3) - VN_MARGIN) >= 0))
+			{
+				clipflags &= ~(1<<i);
+				accepted |= 1<<i;
+				continue;
 			}
-			else if (dot > BACKFACE_EPSILON)
+
+			if ((R_VisNodeCorner (vn, i, pindex) + VN_MARGIN) <= 0)
 			{
-				do
-				{
-					if (!(surf->flags & SURF_PLANEBACK) &&
-						(surf->visframe == r_framecount))
-					{
-						if (r_drawpolys)
-						{
-							if (r_worldpolysbacktofront)
-							{
-								if (numbtofpolys < MAX_BTOFPOLYS)
-								{
-									pbtofpolys[numbtofpolys].clipflags =
-											clipflags;
-									pbtofpolys[numbtofpolys].psurf = surf;
-									numbtofpolys++;
-								}
-							}
-							else
-							{
-								R_RenderPoly (surf, clipflags);
-							}
-						}
-						else
-						{
-							R_RenderFace (surf, clipflags);
-						}
-					}
+				vn->accepted = 0;
+				return;
+			}
 
-					surf++;
-				} while (--c);
+			if ((R_VisNodeCorner (vn, i, pindex + 3) - VN_MARGIN) >= 0)
+			{
+				clipflags &= ~(1<<i);	// node is entirely on screen
+				accepted |= 1<<i;
 			}
+		}
 
-		// all surfaces on the same node share the same sequence number
-			r_currentkey++;
+		vn->accepted = accepted;
+	}
+
+// if a leaf node, draw stuff
+	if (vn->numsurfaces < 0)
+	{
+		pleaf = vn->leaf;
+
+		mark = pleaf->firstmarksurface;
+		c = pleaf->nummarksurfaces;
+
+		if (c)
+		{
+			do
+			{
+				(*mark)->visframe = r_framecount;
+				mark++;
+			} while (--c);
 		}
 
-	// recurse down the back side
-		R_RecursiveWorldNode (node->children[!side], clipflags);
+	// deal with model fragments in this leaf
+		if (pleaf->efrags)
+		{
+			R_StoreEfrags (&pleaf->efrags);
+		}
+
+		pleaf->key = r_currentkey;
+		r_currentkey++;		// all bmodels in a leaf share the same key
+		return;
 	}
-}
 
+// node is just a decision point, so go down the apropriate sides
+
+// find which side of the node we are on
+	plane = vn->plane;
+
+	switch (plane->type)
+	{
+	case PLANE_X:
+		dot = modelorg[0] - plane->dist;
+		break;
+	case PLANE_Y:
+		dot = modelorg[1] - plane->dist;
+		break;
+	case PLANE_Z:
+		dot = modelorg[2] - plane->dist;
+		break;
+	default:
+		dot = DotProduct (modelorg, plane->normal) - plane->dist;
+		break;
+	}
+
+	side = (dot >= 0) ? 0 : 1;
+
+// recurse down the children, front side first
+	if (vn->children[side])
+		R_RecursiveVisNode (vn->children[side], clipflags);
+
+// draw stuff
+	if (vn->numsurfaces)
+	{
+		R_DrawNodeSurfaces (vn->firstsurface, vn->numsurfaces, dot, clipflags);
+
+	// all surfaces on the same node share the same sequence number
+		r_currentkey++;
+	}
+
+// recurse down the back side
+	if (vn->children[!side])
+		R_RecursiveVisNode (vn->children[!side], clipflags);
+}
 
 
 /*
@@ -658,7 +944,15 @@ void R_RenderWorld (void)
 	clmodel = currententity->model;
 	r_pcurrentvertbase = clmodel->vertexes;
 
-	R_RecursiveWorldNode (clmodel->nodes, 15);
+	if (r_worldcache.value && R_BuildVisNodes ())
+	{
+		R_SetVisNodeFrustum ();
+		R_RecursiveVisNode (r_vnoderoot, 15);
+	}
+	else
+	{
+		R_RecursiveWorldNode (clmodel->nodes, 15);
+	}
 
 // if the driver wants the polygons back to front, play the visible ones back
 // in that order
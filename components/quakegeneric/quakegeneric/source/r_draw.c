@@ -52,7 +52,7 @@ static qboolean	makeleftedge, makerightedge;
 qboolean		r_nearzionly;
 
 EXT_RAM_BSS_ATTR int		sintable[SIN_BUFFER_SIZE];
-EXT_RAM_BSS_ATTR int		intsintable[SIN_BUFFER_SIZE];
+byte		intsintable[SIN_BUFFER_SIZE];	// read per pixel by the warp
 
 mvertex_t	r_leftenter, r_leftexit;
 mvertex_t	r_rightenter, r_rightexit;
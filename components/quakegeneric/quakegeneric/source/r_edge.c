@@ -34,7 +34,6 @@ have a sentinal at both ends?
 #endif
 
 
-edge_t	*auxedges;
 edge_t	*r_edges, *edge_p, *edge_max;
 
 surf_t	*surfaces, *surface_p, *surf_max;
@@ -67,10 +66,15 @@ float	fv;
 
 void R_GenerateSpans (void);
 void R_GenerateSpansBackward (void);
+static void R_GenerateSpansArray (void);
+static void R_GenerateSpansBackwardArray (void);
 
-void R_LeadingEdge (edge_t *edge);
-void R_LeadingEdgeBackwards (edge_t *edge);
-void R_TrailingEdge (surf_t *surf, edge_t *edge);
+void R_LeadingEdge (edge_t *edge, int u);
+void R_LeadingEdgeBackwards (edge_t *edge, int u);
+void R_TrailingEdge (surf_t *surf, int u);
+
+static qboolean	r_edgearraysactive;
+static qboolean R_AllocEdgeArrays (void);
 
 
 //=============================================================================
@@ -136,16 +140,19 @@ void R_BeginEdgeFrame (void)
 	surfaces[1].spans = NULL;	// no background spans yet
 	surfaces[1].flags = SURF_DRAWBACKGROUND;
 
+	r_edgearraysactive = r_edgearrays.value && R_AllocEdgeArrays ();
+
 // put the background behind everything in the world
 	if (r_draworder.value)
 	{
-		pdrawfunc = R_GenerateSpansBackward;
+		pdrawfunc = r_edgearraysactive ? R_GenerateSpansBackwardArray :
+				R_GenerateSpansBackward;
 		surfaces[1].key = 0;
 		r_currentkey = 1;
 	}
 	else
 	{
-		pdrawfunc = R_GenerateSpans;
+		pdrawfunc = r_edgearraysactive ? R_GenerateSpansArray : R_GenerateSpans;
 		surfaces[1].key = 0x7FFFFFFF;
 		r_currentkey = 0;
 	}
@@ -317,7 +324,7 @@ void R_CleanupSpan ()
 R_LeadingEdgeBackwards
 ==============
 */
-void R_LeadingEdgeBackwards (edge_t *edge)
+void R_LeadingEdgeBackwards (edge_t *edge, int u)
 {
 	espan_t			*span;
 	surf_t			*surf, *surf2;
@@ -367,7 +374,7 @@ continue_search:
 
 newtop:
 	// emit a span (obscures current top)
-		iu = edge->u >> 20;
+		iu = u >> 20;
 
 		if (iu > surf2->last_u)
 		{
@@ -397,7 +404,7 @@ gotposition:
 R_TrailingEdge
 ==============
 */
-void R_TrailingEdge (surf_t *surf, edge_t *edge)
+void R_TrailingEdge (surf_t *surf, int u)
 {
 	espan_t			*span;
 	int				iu;
@@ -413,7 +420,7 @@ void R_TrailingEdge (surf_t *surf, edge_t *edge)
 		if (surf == surfaces[1].next)
 		{
 		// emit a span (current top going away)
-			iu = edge->u >> 20;
+			iu = u >> 20;
 			if (iu > surf->last_u)
 			{
 				span = span_p++;
@@ -438,7 +445,7 @@ void R_TrailingEdge (surf_t *surf, edge_t *edge)
 R_LeadingEdge
 ==============
 */
-void R_LeadingEdge (edge_t *edge)
+void R_LeadingEdge (edge_t *edge, int u)
 {
 	espan_t			*span;
 	surf_t			*surf, *surf2;
@@ -468,7 +475,7 @@ void R_LeadingEdge (edge_t *edge)
 			if (surf->insubmodel && (surf->key == surf2->key))
 			{
 			// must be two bmodels in the same leaf; sort on 1/z
-				fu = (float)(edge->u - 0xFFFFF) * (1.0 / 0x100000);
+				fu = (float)(u - 0xFFFFF) * (1.0 / 0x100000);
 				newzi = surf->d_ziorigin + fv*surf->d_zistepv +
 						fu*surf->d_zistepu;
 				newzibottom = newzi * 0.99;
@@ -506,7 +513,7 @@ continue_search:
 					goto continue_search;
 
 			// must be two bmodels in the same leaf; sort on 1/z
-				fu = (float)(edge->u - 0xFFFFF) * (1.0 / 0x100000);
+				fu = (float)(u - 0xFFFFF) * (1.0 / 0x100000);
 				newzi = surf->d_ziorigin + fv*surf->d_zistepv +
 						fu*surf->d_zistepu;
 				newzibottom = newzi * 0.99;
@@ -535,7 +542,7 @@ continue_search:
 
 newtop:
 		// emit a span (obscures current top)
-			iu = edge->u >> 20;
+			iu = u >> 20;
 
 			if (iu > surf2->last_u)
 			{
@@ -585,13 +592,13 @@ void R_GenerateSpans (void)
 		// it has a left surface, so a surface is going away for this span
 			surf = &surfaces[edge->surfs[0]];
 
-			R_TrailingEdge (surf, edge);
+			R_TrailingEdge (surf, edge->u);
 
 			if (!edge->surfs[1])
 				continue;
 		}
 
-		R_LeadingEdge (edge);
+		R_LeadingEdge (edge, edge->u);
 	}
 
 	R_CleanupSpan ();
@@ -616,10 +623,249 @@ void R_GenerateSpansBackward (void)
 	for (edge=edge_head.next ; edge != &edge_tail; edge=edge->next)
 	{			
 		if (edge->surfs[0])
-			R_TrailingEdge (&surfaces[edge->surfs[0]], edge);
+			R_TrailingEdge (&surfaces[edge->surfs[0]], edge->u);
 
 		if (edge->surfs[1])
-			R_LeadingEdgeBackwards (edge);
+			R_LeadingEdgeBackwards (edge, edge->u);
+	}
+
+	R_CleanupSpan ();
+}
+
+
+/*
+===============================================================================
+
+ACTIVE EDGE ARRAYS
+
+With r_edgearrays set, the active edges are kept in parallel arrays sorted on
+u instead of the linked list above. Stepping u is then one add down a
+contiguous array, the re-sort an insertion pass over a nearly sorted one, and
+new and finished edges go in with a merge and out with a compaction. The
+spans come out exactly as the list makes them: new edges go in front of
+active ones at the same u, and a stepped edge only moves back past edges
+strictly to its right.
+
+The list links of an edge aren't used while it is in the arrays, so a
+finished edge is marked by clearing its prev.
+
+===============================================================================
+*/
+
+static int		*r_aeu, *r_aeustep;
+static edge_t	**r_aeedge;
+static edge_t	**r_aenew;			// scratch for the edges being merged in
+static int		r_aenum;			// active edges
+static int		r_aemax;			// room in the arrays
+
+/*
+==============
+R_AllocEdgeArrays
+
+Every edge of a frame could be active at once, so the arrays grow with
+r_numallocatededges; returns false if they can't be had
+==============
+*/
+static qboolean R_AllocEdgeArrays (void)
+{
+	if (r_aemax >= r_numallocatededges)
+		return true;
+
+	free (r_aeu);
+	free (r_aeustep);
+	free (r_aeedge);
+	free (r_aenew);
+	r_aeu = malloc (r_numallocatededges * sizeof(*r_aeu));
+	r_aeustep = malloc (r_numallocatededges * sizeof(*r_aeustep));
+	r_aeedge = malloc (r_numallocatededges * sizeof(*r_aeedge));
+	r_aenew = malloc (r_numallocatededges * sizeof(*r_aenew));
+
+	if (!r_aeu || !r_aeustep || !r_aeedge || !r_aenew)
+	{
+		r_aemax = 0;
+		return false;
+	}
+
+	r_aemax = r_numallocatededges;
+	return true;
+}
+
+/*
+==============
+R_InsertNewEdgesArray
+
+edgestoadd is sorted on u, as for R_InsertNewEdges
+==============
+*/
+static void R_InsertNewEdgesArray (edge_t *edgestoadd)
+{
+	int		i, j, dest, u;
+	edge_t	*edge;
+
+	for (j=0 ; edgestoadd ; edgestoadd = edgestoadd->next)
+		r_aenew[j++] = edgestoadd;
+
+// merge from the top down, so nothing has to move twice
+	i = r_aenum - 1;
+	j--;
+	dest = r_aenum + j;
+	r_aenum = dest + 1;
+
+	while (j >= 0)
+	{
+		edge = r_aenew[j];
+		u = edge->u;
+
+		if (i >= 0 && r_aeu[i] >= u)
+		{
+			r_aeu[dest] = r_aeu[i];
+			r_aeustep[dest] = r_aeustep[i];
+			r_aeedge[dest] = r_aeedge[i];
+			i--;
+		}
+		else
+		{
+			r_aeu[dest] = u;
+			r_aeustep[dest] = edge->u_step;
+			r_aeedge[dest] = edge;
+			edge->prev = edge;		// active
+			j--;
+		}
+		dest--;
+	}
+}
+
+/*
+==============
+R_RemoveEdgesArray
+==============
+*/
+static void R_RemoveEdgesArray (edge_t *pedge)
+{
+	int		i, j;
+
+	do
+	{
+		pedge->prev = NULL;
+	} while ((pedge = pedge->nextremove) != NULL);
+
+	for (i=j=0 ; i<r_aenum ; i++)
+	{
+		if (!r_aeedge[i]->prev)
+			continue;
+		r_aeu[j] = r_aeu[i];
+		r_aeustep[j] = r_aeustep[i];
+		r_aeedge[j] = r_aeedge[i];
+		j++;
+	}
+
+	r_aenum = j;
+}
+
+/*
+==============
+R_StepActiveArray
+==============
+*/
+static void R_StepActiveArray (void)
+{
+	int		i, j, n, u, ustep;
+	int		*au, *as;
+	edge_t	*edge;
+
+	n = r_aenum;
+	au = r_aeu;
+	as = r_aeustep;
+
+	for (i=0 ; i<n ; i++)
+		au[i] += as[i];
+
+// the edges rarely cross, so this is usually one compare per edge
+	for (i=1 ; i<n ; i++)
+	{
+		if (au[i] >= au[i-1])
+			continue;
+
+		u = au[i];
+		ustep = as[i];
+		edge = r_aeedge[i];
+		j = i - 1;
+		do
+		{
+			au[j+1] = au[j];
+			as[j+1] = as[j];
+			r_aeedge[j+1] = r_aeedge[j];
+			j--;
+		} while (j >= 0 && au[j] > u);
+
+		au[j+1] = u;
+		as[j+1] = ustep;
+		r_aeedge[j+1] = edge;
+	}
+}
+
+/*
+==============
+R_GenerateSpansArray
+==============
+*/
+static void R_GenerateSpansArray (void)
+{
+	int				i;
+	edge_t			*edge;
+
+	r_bmodelactive = 0;
+
+// clear active surfaces to just the background surface
+	surfaces[1].next = surfaces[1].prev = &surfaces[1];
+	surfaces[1].last_u = edge_head_u_shift20;
+
+// generate spans
+	for (i=0 ; i<r_aenum ; i++)
+	{
+		edge = r_aeedge[i];
+
+		if (edge->surfs[0])
+		{
+		// it has a left surface, so a surface is going away for this span
+			R_TrailingEdge (&surfaces[edge->surfs[0]], r_aeu[i]);
+
+			if (!edge->surfs[1])
+				continue;
+		}
+
+		R_LeadingEdge (edge, r_aeu[i]);
+	}
+
+	R_CleanupSpan ();
+}
+
+/*
+==============
+R_GenerateSpansBackwardArray
+==============
+*/
+static void R_GenerateSpansBackwardArray (void)
+{
+	int				i;
+	edge_t			*edge;
+
+	r_bmodelactive = 0;
+
+// clear active surfaces to just the background surface
+	surfaces[1].next = surfaces[1].prev = &surfaces[1];
+	surfaces[1].last_u = edge_head_u_shift20;
+
+// generate spans
+	for (i=0 ; i<r_aenum ; i++)
+	{
+		edge = r_aeedge[i];
+
+		if (edge->surfs[0])
+			R_TrailingEdge (&surfaces[edge->surfs[0]], r_aeu[i]);
+
+		if (edge->surfs[1])
+			R_LeadingEdgeBackwards (edge, r_aeu[i]);
 	}
 
 	R_CleanupSpan ();
@@ -641,13 +887,13 @@ Each surface has a linked list of its visible spans
 void R_ScanEdges (void)
 {
 	int		iv, bottom;
-	byte	basespans[MAXSPANS*sizeof(espan_t)+CACHE_SIZE];
 	espan_t	*basespan_p;
 	surf_t	*s;
 
-	basespan_p = (espan_t *)
-			((intptr_t)(basespans + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
-	max_span_p = &basespan_p[MAXSPANS - r_refdef.vrect.width];
+// the span pool comes from R_NewMap rather than the stack, so when tiling the
+// spans also outlive this call, as they are drawn a band at a time afterwards
+	basespan_p = r_spans;
+	max_span_p = &basespan_p[r_numallocatedspans - r_refdef.vrect.width];
 
 	span_p = basespan_p;
 
@@ -678,6 +924,8 @@ void R_ScanEdges (void)
 	edge_sentinel.u = 2000 << 24;		// make sure nothing sorts past this
 	edge_sentinel.prev = &edge_aftertail;
 
+	r_aenum = 0;
+
 //	
 // process all scan lines
 //
@@ -693,7 +941,10 @@ void R_ScanEdges (void)
 
 		if (newedges[iv])
 		{
-			R_InsertNewEdges (newedges[iv], edge_head.next);
+			if (r_edgearraysactive)
+				R_InsertNewEdgesArray (newedges[iv]);
+			else
+				R_InsertNewEdges (newedges[iv], edge_head.next);
 		}
 
 		(*pdrawfunc) ();
@@ -702,10 +953,17 @@ void R_ScanEdges (void)
 	// the next scan
 		if (span_p >= max_span_p)
 		{
+			r_spansused += span_p - basespan_p;
+			r_spanflushes++;
+
 			VID_UnlockBuffer ();
 			S_ExtraUpdate ();	// don't let sound get messed up if going slow
 			VID_LockBuffer ();
-		
+
+		// out of room to keep the whole frame's spans, so just draw this
+		// frame directly
+			D_EndTiles ();
+
 			if (r_drawculledpolys)
 			{
 				R_DrawCulledPolys ();
@@ -722,6 +980,15 @@ void R_ScanEdges (void)
 			span_p = basespan_p;
 		}
 
+		if (r_edgearraysactive)
+		{
+			if (removeedges[iv])
+				R_RemoveEdgesArray (removeedges[iv]);
+
+			R_StepActiveArray ();
+			continue;
+		}
+
 		if (removeedges[iv])
 			R_RemoveEdges (removeedges[iv]);
 
@@ -738,14 +1005,21 @@ void R_ScanEdges (void)
 	surfaces[1].spanstate = 1;
 
 	if (newedges[iv])
-		R_InsertNewEdges (newedges[iv], edge_head.next);
+	{
+		if (r_edgearraysactive)
+			R_InsertNewEdgesArray (newedges[iv]);
+		else
+			R_InsertNewEdges (newedges[iv], edge_head.next);
+	}
 
 	(*pdrawfunc) ();
 
-// draw whatever's left in the span list
+	r_spansused += span_p - basespan_p;
+
+// draw whatever's left in the span list; when tiling, R_DrawTiles does it
 	if (r_drawculledpolys)
 		R_DrawCulledPolys ();
-	else
+	else if (!d_tiling)
 		D_DrawSurfaces ();
 }
 
@@ -61,6 +61,10 @@ extern cvar_t	r_waterwarp;
 extern cvar_t	r_fullbright;
 extern cvar_t	r_drawentities;
 extern cvar_t	r_aliasstats;
+extern cvar_t	r_bmodelstats;
+extern cvar_t	r_bmodelcull;
+extern cvar_t	r_spriterect;
+extern cvar_t	r_particlestats;
 extern cvar_t	r_dspeeds;
 extern cvar_t	r_drawflat;
 extern cvar_t	r_ambient;
@@ -70,6 +74,13 @@ extern cvar_t	r_numsurfs;
 extern cvar_t	r_reportedgeout;
 extern cvar_t	r_maxedges;
 extern cvar_t	r_numedges;
+extern cvar_t	r_aliasmemo;
+extern cvar_t	r_aliaslod;
+extern cvar_t	r_aliaslod1;
+extern cvar_t	r_aliaslod2;
+extern cvar_t	r_edgearrays;
+extern cvar_t	r_worldcache;
+extern cvar_t	r_poolautosize;
 
 #define XCENTERING	(1.0 / 2.0)
 #define YCENTERING	(1.0 / 2.0)
@@ -129,6 +140,7 @@ extern	vec3_t			r_worldmodelorg;
 
 
 void R_DrawSprite (void);
+mspriteframe_t *R_GetSpriteframe (msprite_t *psprite);
 void R_RenderFace (msurface_t *fa, int clipflags);
 void R_RenderPoly (msurface_t *fa, int clipflags);
 void R_RenderBmodelFace (bedge_t *pedges, msurface_t *psurf);
@@ -225,6 +237,8 @@ extern int				r_acliptype;
 extern finalvert_t		*pfinalverts;
 extern auxvert_t		*pauxverts;
 
+extern float			r_aliasscreenmins[2], r_aliasscreenmaxs[2];
+
 qboolean R_AliasCheckBBox (void);
 
 //=========================================================
@@ -238,13 +252,21 @@ qboolean R_AliasCheckBBox (void);
 // particle stuff
 
 void R_DrawParticles (void);
+void R_MoveParticles (void);
+void R_MarkParticleZNeeds (void);
 void R_InitParticles (void);
 void R_ClearParticles (void);
+void R_AddParticle (particle_t *p);
+void R_PrintParticleStats (void);
 void R_ReadPointFile_f (void);
 void R_SurfacePatch (void);
+void R_CheckPools (void);
+void R_PoolStats_f (void);
 
-extern int		r_amodels_drawn;
-extern edge_t	*auxedges;
+extern int		r_amodels_drawn, r_amodels_memoised;
+extern int		r_amodels_reduced, r_atris_drawn;
+extern int		r_bmodels_drawn, r_bmodels_culled, r_bmodels_placed;
+extern int		r_bmodelpolys;
 extern int		r_numallocatededges;
 extern edge_t	*r_edges, *edge_p, *edge_max;
 
@@ -276,7 +298,8 @@ extern float	dp_time1, dp_time2, db_time1, db_time2, rw_time1, rw_time2;
 extern float	se_time1, se_time2, de_time1, de_time2, dv_time1, dv_time2;
 extern int		r_frustum_indexes[4*6];
 extern int		r_maxsurfsseen, r_maxedgesseen, r_cnumsurfs;
-extern qboolean	r_surfsonstack;
+extern int		r_numallocatedspans, r_spansused, r_spanflushes;
+extern espan_t	*r_spans;
 extern cshift_t	cshift_water;
 extern qboolean	r_dowarpold, r_viewchanged;
 
@@ -292,6 +315,7 @@ void R_StoreEfrags (efrag_t **ppefrag);
 void R_TimeRefresh_f (void);
 void R_TimeGraph (void);
 void R_PrintAliasStats (void);
+void R_PrintBModelStats (void);
 void R_PrintTimes (void);
 void R_PrintDSpeeds (void);
 void R_AnimateLight (void);
@@ -302,3 +326,8 @@ void R_EmitEdge (mvertex_t *pv0, mvertex_t *pv1);
 void R_ClipEdge (mvertex_t *pv0, mvertex_t *pv1, clipplane_t *clip);
 void R_SplitEntityOnNode2 (mnode_t *node);
 void R_MarkLights (dlight_t *light, int bit, mnode_t *node);
+void R_MarkZBox (vec3_t mins, vec3_t maxs);
+void R_MarkZNeeds (void);
+void R_AliasClearMemo (void);
+void R_DrawTiles (void);
+qboolean R_AliasInTile (void);
@@ -45,7 +45,6 @@ mvertex_t	*r_pcurrentvertbase;
 
 int			c_surf;
 int			r_maxsurfsseen, r_maxedgesseen, r_cnumsurfs;
-qboolean	r_surfsonstack;
 int			r_clipflags;
 
 byte		*r_warpbuffer;
@@ -91,6 +90,9 @@ int		r_polycount;
 int		r_drawnpolycount;
 int		r_wholepolycount;
 
+int		r_bmodels_drawn, r_bmodels_culled, r_bmodels_placed;
+static int	r_placementmap;
+
 #define		VIEWMODNAME_LENGTH	256
 char		viewmodname[VIEWMODNAME_LENGTH+1];
 int			modcount;
@@ -124,6 +126,10 @@ cvar_t	r_fullbright = {"r_fullbright","0"};
 cvar_t	r_drawentities = {"r_drawentities","1"};
 cvar_t	r_drawviewmodel = {"r_drawviewmodel","1"};
 cvar_t	r_aliasstats = {"r_polymodelstats","0"};
+cvar_t	r_bmodelstats = {"r_bmodelstats","0"};
+cvar_t	r_bmodelcull = {"r_bmodelcull","1"};
+cvar_t	r_spriterect = {"r_spriterect","1"};
+cvar_t	r_particlestats = {"r_particlestats","0"};
 cvar_t	r_dspeeds = {"r_dspeeds","0"};
 cvar_t	r_drawflat = {"r_drawflat", "0"};
 cvar_t	r_ambient = {"r_ambient", "0"};
@@ -135,6 +141,13 @@ cvar_t	r_maxedges = {"r_maxedges", "0"};
 cvar_t	r_numedges = {"r_numedges", "0"};
 cvar_t	r_aliastransbase = {"r_aliastransbase", "200"};
 cvar_t	r_aliastransadj = {"r_aliastransadj", "100"};
+cvar_t	r_aliasmemo = {"r_aliasmemo", "1"};
+cvar_t	r_aliaslod = {"r_aliaslod", "1"};
+cvar_t	r_aliaslod1 = {"r_aliaslod1", "48"};
+cvar_t	r_aliaslod2 = {"r_aliaslod2", "20"};
+cvar_t	r_edgearrays = {"r_edgearrays", "1"};
+cvar_t	r_worldcache = {"r_worldcache", "1"};
+cvar_t	r_poolautosize = {"r_poolautosize", "1"};
 
 extern cvar_t	scr_fov;
 
@@ -190,6 +203,7 @@ void R_Init (void)
 	
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);	
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);	
+	Cmd_AddCommand ("r_poolstats", R_PoolStats_f);
 
 	Cvar_RegisterVariable (&r_draworder);
 	Cvar_RegisterVariable (&r_speeds);
@@ -203,6 +217,10 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_drawentities);
 	Cvar_RegisterVariable (&r_drawviewmodel);
 	Cvar_RegisterVariable (&r_aliasstats);
+	Cvar_RegisterVariable (&r_bmodelstats);
+	Cvar_RegisterVariable (&r_bmodelcull);
+	Cvar_RegisterVariable (&r_spriterect);
+	Cvar_RegisterVariable (&r_particlestats);
 	Cvar_RegisterVariable (&r_dspeeds);
 	Cvar_RegisterVariable (&r_reportsurfout);
 	Cvar_RegisterVariable (&r_maxsurfs);
@@ -212,9 +230,16 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_numedges);
 	Cvar_RegisterVariable (&r_aliastransbase);
 	Cvar_RegisterVariable (&r_aliastransadj);
+	Cvar_RegisterVariable (&r_aliasmemo);
+	Cvar_RegisterVariable (&r_aliaslod);
+	Cvar_RegisterVariable (&r_aliaslod1);
+	Cvar_RegisterVariable (&r_aliaslod2);
+	Cvar_RegisterVariable (&r_edgearrays);
+	Cvar_RegisterVariable (&r_worldcache);
+	Cvar_RegisterVariable (&r_poolautosize);
 
-	Cvar_SetValue ("r_maxedges", (float)NUMSTACKEDGES);
-	Cvar_SetValue ("r_maxsurfs", (float)NUMSTACKSURFACES);
+	Cvar_SetValue ("r_maxedges", (float)MINEDGES);
+	Cvar_SetValue ("r_maxsurfs", (float)MINSURFACES);
 
 	view_clipplanes[0].leftedge = true;
 	view_clipplanes[1].rightedge = true;
@@ -231,6 +256,226 @@ void R_Init (void)
 	D_Init ();
 }
 
+/*
+===============================================================================
+
+POOL SIZING
+
+The edge, surface and span pools are sized per map.  Each frame notes how
+much of each it needed, counting what was dropped for want of room, and the
+highest figures are remembered by map name so the next load of that map
+starts with pools that fit.  A frame that overflows anyway gets bigger pools
+from the low hunk for the frames after it; the outgrown ones are given back
+with the rest of the map.
+
+===============================================================================
+*/
+
+#define MAX_POOLMARKS	32
+
+typedef struct
+{
+	char	name[MAX_QPATH];
+	int		edges, surfs, spans;	// most needed by a single frame
+} poolmark_t;
+
+static poolmark_t	r_poolmarks[MAX_POOLMARKS];
+static int			r_numpoolmarks;
+static poolmark_t	*r_poolmark;	// the current map's
+
+espan_t		*r_spans;
+int			r_numallocatedspans;
+int			r_spansused, r_spanflushes;		// this frame
+
+static int	r_poolgrows, r_pooldropframes, r_poolflushframes;	// this map
+
+/*
+===============
+R_FindPoolMark
+
+Marks for a map not seen before replace the oldest ones once the table fills
+===============
+*/
+static poolmark_t *R_FindPoolMark (char *name)
+{
+	int			i;
+	poolmark_t	*pm;
+
+	for (i=0 ; i<r_numpoolmarks && i<MAX_POOLMARKS ; i++)
+		if (!Q_strcmp (r_poolmarks[i].name, name))
+			return &r_poolmarks[i];
+
+	pm = &r_poolmarks[r_numpoolmarks % MAX_POOLMARKS];
+	r_numpoolmarks++;
+
+	memset (pm, 0, sizeof(*pm));
+	Q_strncpy (pm->name, name, sizeof(pm->name) - 1);
+
+	return pm;
+}
+
+/*
+===============
+R_PoolSize
+===============
+*/
+static int R_PoolSize (int wanted, int minimum, int mark)
+{
+	if (wanted < minimum)
+		wanted = minimum;
+
+// a quarter again over the worst frame seen
+	if (r_poolautosize.value && mark + (mark >> 2) > wanted)
+		wanted = mark + (mark >> 2);
+
+	return wanted;
+}
+
+/*
+===============
+R_AllocSurfaces
+===============
+*/
+static void R_AllocSurfaces (int count)
+{
+	r_cnumsurfs = count;
+
+	surfaces = Hunk_PlacedAlloc (r_cnumsurfs * sizeof(surf_t), "surfaces");
+	surface_p = surfaces;
+	surf_max = &surfaces[r_cnumsurfs];
+// surface 0 doesn't really exist; it's just a dummy because index 0
+// is used to indicate no edge attached to surface
+	surfaces--;
+	R_SurfacePatch ();
+}
+
+/*
+===============
+R_AllocEdges
+===============
+*/
+static void R_AllocEdges (int count)
+{
+	r_numallocatededges = count;
+
+	r_edges = Hunk_PlacedAlloc (r_numallocatededges * sizeof(edge_t), "edges");
+}
+
+/*
+===============
+R_AllocSpans
+===============
+*/
+static void R_AllocSpans (int count)
+{
+	r_numallocatedspans = count;
+
+	r_spans = Hunk_PlacedAlloc (r_numallocatedspans * sizeof(espan_t), "spans");
+}
+
+/*
+===============
+R_CheckPools
+
+Called after each frame to record what it needed, and to grow any pool it
+overflowed while the low hunk has room
+===============
+*/
+void R_CheckPools (void)
+{
+	int		surfs, edges, spans;
+
+	surfs = (surface_p - surfaces) - 1 + r_outofsurfaces;
+	edges = (edge_p - r_edges) + r_outofedges;
+	spans = r_spansused + r_refdef.vrect.width;	// R_ScanEdges keeps a line spare
+
+	if (surfs > r_maxsurfsseen)
+		r_maxsurfsseen = surfs;
+	if (edges > r_maxedgesseen)
+		r_maxedgesseen = edges;
+
+	if (r_outofsurfaces || r_outofedges)
+		r_pooldropframes++;
+	if (r_spanflushes)
+		r_poolflushframes++;
+
+	if (r_poolmark)
+	{
+		if (surfs > r_poolmark->surfs)
+			r_poolmark->surfs = surfs;
+		if (edges > r_poolmark->edges)
+			r_poolmark->edges = edges;
+		if (spans > r_poolmark->spans)
+			r_poolmark->spans = spans;
+	}
+
+	if (!r_poolautosize.value)
+		return;
+
+	if (r_outofsurfaces)
+	{
+		surfs = R_PoolSize (0, r_cnumsurfs, surfs);
+		if (surfs * (int)sizeof(surf_t) <= Hunk_FreeSpace ())
+		{
+			R_AllocSurfaces (surfs);
+			r_poolgrows++;
+		}
+	}
+
+	if (r_outofedges)
+	{
+		edges = R_PoolSize (0, r_numallocatededges, edges);
+		if (edges * (int)sizeof(edge_t) <= Hunk_FreeSpace ())
+		{
+			R_AllocEdges (edges);
+			r_poolgrows++;
+		}
+	}
+
+	if (r_spanflushes)
+	{
+		spans = R_PoolSize (0, r_numallocatedspans, spans);
+		if (spans * (int)sizeof(espan_t) <= Hunk_FreeSpace ())
+		{
+			R_AllocSpans (spans);
+			r_poolgrows++;
+		}
+	}
+}
+
+/*
+===============
+R_PoolStats_f
+===============
+*/
+void R_PoolStats_f (void)
+{
+	int		i;
+
+	if (!cl.worldmodel)
+	{
+		Con_Printf ("no map loaded\n");
+		return;
+	}
+
+	Con_Printf ("%-8s %6s %6s %6s\n", "pool", "alloc", "peak", "best");
+	Con_Printf ("%-8s %6i %6i %6i\n", "surfaces", r_cnumsurfs, r_maxsurfsseen,
+			r_poolmark ? r_poolmark->surfs : 0);
+	Con_Printf ("%-8s %6i %6i %6i\n", "edges", r_numallocatededges,
+			r_maxedgesseen, r_poolmark ? r_poolmark->edges : 0);
+	Con_Printf ("%-8s %6i %6s %6i\n", "spans", r_numallocatedspans, "-",
+			r_poolmark ? r_poolmark->spans : 0);
+	Con_Printf ("%i frames dropped polys, %i flushed spans, %i pools grown\n",
+			r_pooldropframes, r_poolflushframes, r_poolgrows);
+
+	Con_Printf ("%i maps remembered\n", r_numpoolmarks < MAX_POOLMARKS ?
+			r_numpoolmarks : MAX_POOLMARKS);
+	for (i=0 ; i<r_numpoolmarks && i<MAX_POOLMARKS ; i++)
+		Con_Printf ("  %-20s %5i surfs %5i edges %5i spans\n",
+				r_poolmarks[i].name, r_poolmarks[i].surfs, r_poolmarks[i].edges,
+				r_poolmarks[i].spans);
+}
+
 /*
 ===============
 R_NewMap
@@ -247,45 +492,22 @@ void R_NewMap (void)
 		 	
 	r_viewleaf = NULL;
 	R_ClearParticles ();
+	R_AliasClearMemo ();
 
-	r_cnumsurfs = r_maxsurfs.value;
+	r_placementmap++;		// bmodel placements are for the old world
 
-	if (r_cnumsurfs <= MINSURFACES)
-		r_cnumsurfs = MINSURFACES;
+	r_poolmark = R_FindPoolMark (cl.worldmodel->name);
 
-	if (r_cnumsurfs > NUMSTACKSURFACES)
-	{
-		surfaces = Hunk_AllocName (r_cnumsurfs * sizeof(surf_t), "surfaces");
-		surface_p = surfaces;
-		surf_max = &surfaces[r_cnumsurfs];
-		r_surfsonstack = false;
-	// surface 0 doesn't really exist; it's just a dummy because index 0
-	// is used to indicate no edge attached to surface
-		surfaces--;
-		R_SurfacePatch ();
-	}
-	else
-	{
-		r_surfsonstack = true;
-	}
+	R_AllocSurfaces (R_PoolSize (r_maxsurfs.value, MINSURFACES,
+			r_poolmark->surfs));
+	R_AllocEdges (R_PoolSize (r_maxedges.value, MINEDGES, r_poolmark->edges));
+	R_AllocSpans (R_PoolSize (0, MAXSPANS, r_poolmark->spans));
 
 	r_maxedgesseen = 0;
 	r_maxsurfsseen = 0;
-
-	r_numallocatededges = r_maxedges.value;
-
-	if (r_numallocatededges < MINEDGES)
-		r_numallocatededges = MINEDGES;
-
-	if (r_numallocatededges <= NUMSTACKEDGES)
-	{
-		auxedges = NULL;
-	}
-	else
-	{
-		auxedges = Hunk_AllocName (r_numallocatededges * sizeof(edge_t),
-								   "edges");
-	}
+	r_poolgrows = 0;
+	r_pooldropframes = 0;
+	r_poolflushframes = 0;
 
 	r_dowarpold = false;
 	r_viewchanged = false;
@@ -494,6 +716,24 @@ void R_MarkLeaves (void)
 }
 
 
+/*
+=============
+R_AliasInTile
+
+When tiling, rejects alias models R_AliasCheckBBox found to be entirely above
+or below the current band
+=============
+*/
+qboolean R_AliasInTile (void)
+{
+	if (!d_tiling)
+		return true;
+
+	return (r_aliasscreenmaxs[1] >= d_tiley0 - 1) &&
+			(r_aliasscreenmins[1] < d_tiley1 + 1);
+}
+
+
 /*
 =============
 R_DrawEntitiesOnList
@@ -533,7 +773,7 @@ void R_DrawEntitiesOnList (void)
 
 		// see if the bounding box lets us trivially reject, also sets
 		// trivial accept status
-			if (R_AliasCheckBBox ())
+			if (R_AliasCheckBBox () && R_AliasInTile ())
 			{
 				j = R_LightPoint (currententity->origin);
 	
@@ -573,6 +813,186 @@ void R_DrawEntitiesOnList (void)
 	}
 }
 
+/*
+=============
+R_MarkZBox
+
+Marks the screen area a worldspace box projects to, near-clipping the box
+edges that cross the view plane
+=============
+*/
+void R_MarkZBox (vec3_t mins, vec3_t maxs)
+{
+	int		i, j, b, numv;
+	vec3_t	corner, local, view[8];
+	float	pts[8+12][3], frac, zi, u, v;
+	float	umin, umax, vmin, vmax;
+
+	for (i=0 ; i<8 ; i++)
+	{
+		corner[0] = (i & 1) ? maxs[0] : mins[0];
+		corner[1] = (i & 2) ? maxs[1] : mins[1];
+		corner[2] = (i & 4) ? maxs[2] : mins[2];
+		VectorSubtract (corner, r_origin, local);
+		TransformVector (local, view[i]);
+	}
+
+	numv = 0;
+	for (i=0 ; i<8 ; i++)
+	{
+		if (view[i][2] >= NEAR_CLIP)
+		{
+			VectorCopy (view[i], pts[numv]);
+			numv++;
+		}
+
+	// each of the 12 edges joins two corners differing in one axis
+		for (b=0 ; b<3 ; b++)
+		{
+			j = i ^ (1<<b);
+			if (j < i)
+				continue;
+			if ((view[i][2] >= NEAR_CLIP) == (view[j][2] >= NEAR_CLIP))
+				continue;
+
+			frac = (NEAR_CLIP - view[i][2]) / (view[j][2] - view[i][2]);
+			pts[numv][0] = view[i][0] + (view[j][0] - view[i][0]) * frac;
+			pts[numv][1] = view[i][1] + (view[j][1] - view[i][1]) * frac;
+			pts[numv][2] = NEAR_CLIP;
+			numv++;
+		}
+	}
+
+	if (!numv)
+		return;		// entirely behind the view
+
+	umin = vmin = 999999;
+	umax = vmax = -999999;
+
+	for (i=0 ; i<numv ; i++)
+	{
+		zi = 1.0 / pts[i][2];
+		u = xcenter + xscale * zi * pts[i][0];
+		v = ycenter - yscale * zi * pts[i][1];
+
+		if (u < umin)
+			umin = u;
+		if (u > umax)
+			umax = u;
+		if (v < vmin)
+			vmin = v;
+		if (v > vmax)
+			vmax = v;
+	}
+
+// clamp before converting, points on the near plane project far offscreen
+	if (umin < r_refdef.fvrectx)
+		umin = r_refdef.fvrectx;
+	if (vmin < r_refdef.fvrecty)
+		vmin = r_refdef.fvrecty;
+	if (umax > r_refdef.fvrectright)
+		umax = r_refdef.fvrectright;
+	if (vmax > r_refdef.fvrectbottom)
+		vmax = r_refdef.fvrectbottom;
+
+	D_MarkZNeed ((int)umin - 1, (int)vmin - 1, (int)umax + 1, (int)vmax + 1);
+}
+
+
+/*
+=============
+R_MarkZNeeds
+
+Run before the world is drawn, so D_DrawZSpans knows where alias models,
+sprites and particles are going to read z this frame
+=============
+*/
+void R_MarkZNeeds (void)
+{
+	int				i, j, trivial_accept;
+	entity_t		*ent;
+	mspriteframe_t	*pspriteframe;
+	float			radius, h, w;
+	vec3_t			mins, maxs, oldmodelorg;
+
+	D_ClearZNeeds ();
+
+	if (d_zneedall)
+		return;
+
+	VectorCopy (modelorg, oldmodelorg);
+	ent = currententity;
+
+	for (i=0 ; r_drawentities.value && i<cl_numvisedicts ; i++)
+	{
+		currententity = cl_visedicts[i];
+
+		if (currententity == &cl_entities[cl.viewentity])
+			continue;	// don't draw the player
+
+		switch (currententity->model->type)
+		{
+		case mod_sprite:
+			pspriteframe = R_GetSpriteframe (currententity->model->cache.data);
+			h = pspriteframe->up > -pspriteframe->down ?
+					pspriteframe->up : -pspriteframe->down;
+			w = pspriteframe->right > -pspriteframe->left ?
+					pspriteframe->right : -pspriteframe->left;
+			radius = sqrt (h*h + w*w) +
+				fabs (((msprite_t *)currententity->model->cache.data)->beamlength);
+			for (j=0 ; j<3 ; j++)
+			{
+				mins[j] = currententity->origin[j] - radius;
+				maxs[j] = currententity->origin[j] + radius;
+			}
+			R_MarkZBox (mins, maxs);
+			break;
+
+		case mod_alias:
+			VectorCopy (currententity->origin, r_entorigin);
+			VectorSubtract (r_origin, r_entorigin, modelorg);
+
+			trivial_accept = currententity->trivial_accept;
+			if (R_AliasCheckBBox ())
+			{
+				D_MarkZNeed ((int)r_aliasscreenmins[0] - 1,
+						(int)r_aliasscreenmins[1] - 1,
+						(int)r_aliasscreenmaxs[0] + 1,
+						(int)r_aliasscreenmaxs[1] + 1);
+			}
+			currententity->trivial_accept = trivial_accept;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+// superset of the R_DrawViewModel tests; over-marking only costs z writes
+	if (r_drawviewmodel.value && !r_fov_greater_than_90 && cl.viewent.model)
+	{
+		currententity = &cl.viewent;
+		VectorCopy (currententity->origin, r_entorigin);
+		VectorSubtract (r_origin, r_entorigin, modelorg);
+
+	// R_DrawViewModel relies on the viewent never being trivially accepted
+		trivial_accept = currententity->trivial_accept;
+		if (R_AliasCheckBBox ())
+		{
+			D_MarkZNeed ((int)r_aliasscreenmins[0] - 1,
+					(int)r_aliasscreenmins[1] - 1,
+					(int)r_aliasscreenmaxs[0] + 1,
+					(int)r_aliasscreenmaxs[1] + 1);
+		}
+		currententity->trivial_accept = trivial_accept;
+	}
+
+	R_MarkParticleZNeeds ();
+
+	currententity = ent;
+	VectorCopy (oldmodelorg, modelorg);
+}
+
 /*
 =============
 R_DrawViewModel
@@ -707,6 +1127,101 @@ int R_BmodelCheckBBox (model_t *clmodel, float *minmaxs)
 }
 
 
+/*
+=============
+R_PlaceBmodel
+
+Finds the first world node that splits the bmodel's box in r_emins/r_emaxs,
+or the leaf it falls in, reusing the last answer while the entity stays put
+=============
+*/
+mnode_t *R_PlaceBmodel (model_t *clmodel)
+{
+	mnode_t		*node;
+	int			sides;
+
+	if (currententity->placedmap == r_placementmap &&
+		currententity->placedmodel == clmodel &&
+		VectorCompare (currententity->placedorigin, currententity->origin))
+	{
+		return currententity->placednode;
+	}
+
+	node = cl.worldmodel->nodes;
+
+	while (node->contents >= 0)
+	{
+		sides = BOX_ON_PLANE_SIDE(r_emins, r_emaxs, node->plane);
+		if (sides == 3)
+			break;
+		node = node->children[(sides & 1) ? 0 : 1];
+	}
+
+	currententity->placednode = node;
+	currententity->placedmodel = clmodel;
+	VectorCopy (currententity->origin, currententity->placedorigin);
+	currententity->placedmap = r_placementmap;
+	currententity->placedvisframe = -1;
+
+	r_bmodels_placed++;
+
+	return node;
+}
+
+
+/*
+=============
+R_BmodelTouchesVisibleLeaf
+=============
+*/
+qboolean R_BmodelTouchesVisibleLeaf (mnode_t *node)
+{
+	int			sides;
+
+	while (1)
+	{
+		if (node->visframe != r_visframecount)
+			return false;
+
+		if (node->contents < 0)
+			return node->contents != CONTENTS_SOLID;
+
+		sides = BOX_ON_PLANE_SIDE(r_emins, r_emaxs, node->plane);
+
+		if (sides == 3)
+		{
+			if (R_BmodelTouchesVisibleLeaf (node->children[0]))
+				return true;
+			node = node->children[1];
+		}
+		else
+		{
+			node = node->children[(sides & 1) ? 0 : 1];
+		}
+	}
+}
+
+
+/*
+=============
+R_BmodelVisible
+
+True if any leaf the bmodel's box touches is in the current PVS; the answer
+is kept until the entity moves or the view leaf changes
+=============
+*/
+qboolean R_BmodelVisible (mnode_t *topnode)
+{
+	if (currententity->placedvisframe != r_visframecount)
+	{
+		currententity->placedvisible = R_BmodelTouchesVisibleLeaf (topnode);
+		currententity->placedvisframe = r_visframecount;
+	}
+
+	return currententity->placedvisible;
+}
+
+
 /*
 =============
 R_DrawBEntitiesOnList
@@ -718,6 +1233,8 @@ void R_DrawBEntitiesOnList (void)
 	vec3_t		oldorigin;
 	model_t		*clmodel;
 	float		minmaxs[6];
+	mnode_t		*topnode;
+	qboolean	cull;
 
 	if (!r_drawentities.value)
 		return;
@@ -726,6 +1243,10 @@ void R_DrawBEntitiesOnList (void)
 	insubmodel = true;
 	r_dlightframecount = r_framecount;
 
+// polygon drivers z-buffer bmodels, so they don't need the world placement
+	cull = r_bmodelcull.value && !(r_drawpolys | r_drawculledpolys);
+	topnode = NULL;
+
 	for (i=0 ; i<cl_numvisedicts ; i++)
 	{
 		currententity = cl_visedicts[i];
@@ -748,8 +1269,29 @@ void R_DrawBEntitiesOnList (void)
 
 			clipflags = R_BmodelCheckBBox (clmodel, minmaxs);
 
+		// reject bmodels that are outside the PVS before rotating,
+		// lighting or clipping them
+			if (cull && clipflags != BMODEL_FULLY_CLIPPED)
+			{
+				for (j=0 ; j<3 ; j++)
+				{
+					r_emins[j] = minmaxs[j];
+					r_emaxs[j] = minmaxs[3+j];
+				}
+
+				topnode = R_PlaceBmodel (clmodel);
+
+				if (!R_BmodelVisible (topnode))
+				{
+					clipflags = BMODEL_FULLY_CLIPPED;
+					r_bmodels_culled++;
+				}
+			}
+
 			if (clipflags != BMODEL_FULLY_CLIPPED)
 			{
+				r_bmodels_drawn++;
+
 				VectorCopy (currententity->origin, r_entorigin);
 				VectorSubtract (r_origin, r_entorigin, modelorg);
 			// FIXME: is this needed?
@@ -786,15 +1328,22 @@ void R_DrawBEntitiesOnList (void)
 				}
 				else
 				{
-					r_pefragtopnode = NULL;
-
-					for (j=0 ; j<3 ; j++)
+					if (cull)
 					{
-						r_emins[j] = minmaxs[j];
-						r_emaxs[j] = minmaxs[3+j];
+						r_pefragtopnode = topnode;
 					}
+					else
+					{
+						r_pefragtopnode = NULL;
 
-					R_SplitEntityOnNode2 (cl.worldmodel->nodes);
+						for (j=0 ; j<3 ; j++)
+						{
+							r_emins[j] = minmaxs[j];
+							r_emaxs[j] = minmaxs[3+j];
+						}
+
+						R_SplitEntityOnNode2 (cl.worldmodel->nodes);
+					}
 
 					if (r_pefragtopnode)
 					{
@@ -846,32 +1395,6 @@ R_EdgeDrawing
 */
 void R_EdgeDrawing (void)
 {
-	edge_t	ledges[NUMSTACKEDGES +
-				((CACHE_SIZE - 1) / sizeof(edge_t)) + 1];
-	surf_t	lsurfs[NUMSTACKSURFACES +
-				((CACHE_SIZE - 1) / sizeof(surf_t)) + 1];
-
-	if (auxedges)
-	{
-		r_edges = auxedges;
-	}
-	else
-	{
-		r_edges =  (edge_t *)
-				(((intptr_t)&ledges[0] + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
-	}
-
-	if (r_surfsonstack)
-	{
-		surfaces =  (surf_t *)
-				(((intptr_t)&lsurfs[0] + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
-		surf_max = &surfaces[r_cnumsurfs];
-	// surface 0 doesn't really exist; it's just a dummy because index 0
-	// is used to indicate no edge attached to surface
-		surfaces--;
-		R_SurfacePatch ();
-	}
-
 	R_BeginEdgeFrame ();
 
 	if (r_dspeeds.value)
@@ -914,6 +1437,39 @@ void R_EdgeDrawing (void)
 }
 
 
+/*
+================
+R_DrawTiles
+
+Draws the spans R_ScanEdges left behind, the entities and the particles one
+band at a time, bottom to top, so each band's color and z stay in internal
+RAM until they are finished
+================
+*/
+void R_DrawTiles (void)
+{
+	int		y0, y1;
+
+	for (y1 = r_refdef.vrectbottom ; y1 > r_refdef.vrect.y ; y1 = y0)
+	{
+		y0 = y1 - D_TILE_HEIGHT;
+		if (y0 < r_refdef.vrect.y)
+			y0 = r_refdef.vrect.y;
+
+		D_SetTile (y0, y1);
+
+		D_DrawSurfaces ();
+		R_DrawEntitiesOnList ();
+		R_DrawViewModel ();
+		R_DrawParticles ();
+
+		D_FlushTile ();
+	}
+
+	D_EndTiles ();
+}
+
+
 /*
 ================
 R_RenderView
@@ -945,7 +1501,11 @@ SetVisibilityByPassages ();
 
 	if (!cl_entities[0].model || !cl.worldmodel)
 		Sys_Error ("R_RenderView: NULL worldmodel");
-		
+
+	R_MarkZNeeds ();
+
+	D_BeginTiles ();
+
 	if (!r_dspeeds.value)
 	{
 		VID_UnlockBuffer ();
@@ -968,23 +1528,32 @@ SetVisibilityByPassages ();
 		de_time1 = se_time2;
 	}
 
-	R_DrawEntitiesOnList ();
-
-	if (r_dspeeds.value)
+	if (d_tiling)
 	{
-		de_time2 = Sys_FloatTime ();
-		dv_time1 = de_time2;
+		R_DrawTiles ();
 	}
+	else
+	{
+		R_DrawEntitiesOnList ();
 
-	R_DrawViewModel ();
+		if (r_dspeeds.value)
+		{
+			de_time2 = Sys_FloatTime ();
+			dv_time1 = de_time2;
+		}
 
-	if (r_dspeeds.value)
-	{
-		dv_time2 = Sys_FloatTime ();
-		dp_time1 = Sys_FloatTime ();
+		R_DrawViewModel ();
+
+		if (r_dspeeds.value)
+		{
+			dv_time2 = Sys_FloatTime ();
+			dp_time1 = Sys_FloatTime ();
+		}
+
+		R_DrawParticles ();
 	}
 
-	R_DrawParticles ();
+	R_MoveParticles ();
 
 	if (r_dspeeds.value)
 		dp_time2 = Sys_FloatTime ();
@@ -999,6 +1568,12 @@ SetVisibilityByPassages ();
 
 	if (r_aliasstats.value)
 		R_PrintAliasStats ();
+
+	if (r_bmodelstats.value)
+		R_PrintBModelStats ();
+
+	if (r_particlestats.value)
+		R_PrintParticleStats ();
 		
 	if (r_speeds.value)
 		R_PrintTimes ();
@@ -1006,12 +1581,17 @@ SetVisibilityByPassages ();
 	if (r_dspeeds.value)
 		R_PrintDSpeeds ();
 
+	if (d_tilestats.value)
+		D_PrintTileStats ();
+
 	if (r_reportsurfout.value && r_outofsurfaces)
 		Con_Printf ("Short %d surfaces\n", r_outofsurfaces);
 
 	if (r_reportedgeout.value && r_outofedges)
 		Con_Printf ("Short roughly %d edges\n", r_outofedges * 2 / 3);
 
+	R_CheckPools ();
+
 // back to high floating-point precision
 	Sys_HighFPPrecision ();
 }
@@ -214,6 +214,7 @@ R_PrintDSpeeds
 void R_PrintDSpeeds (void)
 {
 	float	ms, dp_time, r_time2, rw_time, db_time, se_time, de_time, dv_time;
+	int		zpct;
 
 	r_time2 = Sys_FloatTime ();
 
@@ -225,9 +226,14 @@ void R_PrintDSpeeds (void)
 	dv_time = (dv_time2 - dv_time1) * 1000;
 	ms = (r_time2 - r_time1) * 1000;
 
-	Con_Printf ("%3i %4.1fp %3iw %4.1fb %3is %4.1fe %4.1fv\n",
+// share of world span pixels that had to write z
+	zpct = 100;
+	if (d_zpixcount)
+		zpct = (d_zpixcount - d_zpixskipped) * 100 / d_zpixcount;
+
+	Con_Printf ("%3i %4.1fp %3iw %4.1fb %3is %4.1fe %4.1fv %3iz\n",
 				(int)ms, dp_time, (int)rw_time, db_time, (int)se_time, de_time,
-				dv_time);
+				dv_time, zpct);
 }
 
 
@@ -238,7 +244,23 @@ R_PrintAliasStats
 */
 void R_PrintAliasStats (void)
 {
-	Con_Printf ("%3i polygon model drawn\n", r_amodels_drawn);
+	Con_Printf ("%3i polygon model drawn, %3i memoised, %3i reduced, "
+			"%5i tris, %4i spans hidden\n", r_amodels_drawn,
+			r_amodels_memoised, r_amodels_reduced, r_atris_drawn,
+			d_spanshidden);
+}
+
+
+/*
+=============
+R_PrintBModelStats
+=============
+*/
+void R_PrintBModelStats (void)
+{
+	Con_Printf ("%3i brush model drawn, %3i culled, %3i placed, %4i polys\n",
+			r_bmodels_drawn, r_bmodels_culled, r_bmodels_placed,
+			r_bmodelpolys);
 }
 
 
@@ -375,9 +397,6 @@ void R_SetupFrame (void)
 
 	if (r_numsurfs.value)
 	{
-		if ((surface_p - surfaces) > r_maxsurfsseen)
-			r_maxsurfsseen = surface_p - surfaces;
-
 		Con_Printf ("Used %d of %d surfs; %d max\n", surface_p - surfaces,
 				surf_max - surfaces, r_maxsurfsseen);
 	}
@@ -386,9 +405,6 @@ void R_SetupFrame (void)
 	{
 		edgecount = edge_p - r_edges;
 
-		if (edgecount > r_maxedgesseen)
-			r_maxedgesseen = edgecount;
-
 		Con_Printf ("Used %d of %d edges; %d max\n", edgecount,
 				r_numallocatededges, r_maxedgesseen);
 	}
@@ -509,8 +525,18 @@ r_refdef.viewangles[2]=    0;
 	r_drawnpolycount = 0;
 	r_wholepolycount = 0;
 	r_amodels_drawn = 0;
+	r_amodels_memoised = 0;
+	r_amodels_reduced = 0;
+	r_atris_drawn = 0;
+	d_spanshidden = 0;
+	r_bmodels_drawn = 0;
+	r_bmodels_culled = 0;
+	r_bmodels_placed = 0;
+	r_bmodelpolys = 0;
 	r_outofsurfaces = 0;
 	r_outofedges = 0;
+	r_spansused = 0;
+	r_spanflushes = 0;
 
 	D_SetupFrame ();
 }
@@ -30,10 +30,24 @@ int		ramp1[8] = {0x6f, 0x6d, 0x6b, 0x69, 0x67, 0x65, 0x63, 0x61};
 int		ramp2[8] = {0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66};
 int		ramp3[8] = {0x6d, 0x6b, 6, 5, 4, 3};
 
-particle_t	*active_particles, *free_particles;
+// Live particles are kept as parallel arrays, grouped into one contiguous
+// run per type so the physics can run a tight loop over each type.  The runs
+// follow each other in ptype_t order; adding a particle to a run moves the
+// first particle of every later run to that run's end.
+
+#define PT_NUMTYPES		(pt_blob2 + 1)
 
-particle_t	*particles;
 int			r_numparticles;
+int			r_numactiveparticles;
+
+static float	*r_porg[3], *r_pvel[3];
+static float	*r_pramp, *r_pdie;
+static byte		*r_pcolor;
+
+static int		r_ptypestart[PT_NUMTYPES], r_ptypecount[PT_NUMTYPES];
+static int		r_pprojectframe;
+
+double		r_partmovetime, r_partdrawtime;
 
 vec3_t			r_pright, r_pup, r_ppn;
 
@@ -46,6 +60,7 @@ R_InitParticles
 void R_InitParticles (void)
 {
 	int		i;
+	float	*f;
 
 	i = COM_CheckParm ("-particles");
 
@@ -60,8 +75,79 @@ void R_InitParticles (void)
 		r_numparticles = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *)
-			Hunk_AllocName (r_numparticles * sizeof(particle_t), "particles");
+	f = (float *)Hunk_AllocName (r_numparticles * (8 * sizeof(float) + 1),
+			"particles");
+
+	for (i=0 ; i<3 ; i++)
+	{
+		r_porg[i] = f + i * r_numparticles;
+		r_pvel[i] = f + (i + 3) * r_numparticles;
+	}
+	r_pramp = f + 6 * r_numparticles;
+	r_pdie = f + 7 * r_numparticles;
+	r_pcolor = (byte *)(f + 8 * r_numparticles);
+
+	D_InitParticles (r_numparticles);
+}
+
+
+/*
+===============
+R_CopyParticle
+===============
+*/
+static void R_CopyParticle (int to, int from)
+{
+	r_porg[0][to] = r_porg[0][from];
+	r_porg[1][to] = r_porg[1][from];
+	r_porg[2][to] = r_porg[2][from];
+	r_pvel[0][to] = r_pvel[0][from];
+	r_pvel[1][to] = r_pvel[1][from];
+	r_pvel[2][to] = r_pvel[2][from];
+	r_pramp[to] = r_pramp[from];
+	r_pdie[to] = r_pdie[from];
+	r_pcolor[to] = r_pcolor[from];
+}
+
+
+/*
+===============
+R_AddParticle
+
+Copies a filled in particle_t into the run for its type
+===============
+*/
+void R_AddParticle (particle_t *p)
+{
+	int		i, t;
+
+	t = p->type;
+	if ((r_numactiveparticles >= r_numparticles) ||
+		(t < 0) || (t >= PT_NUMTYPES))
+		return;
+
+// open a slot at the end of run t
+	for (i=PT_NUMTYPES-1 ; i>t ; i--)
+	{
+		if (r_ptypecount[i])
+			R_CopyParticle (r_ptypestart[i] + r_ptypecount[i],
+					r_ptypestart[i]);
+		r_ptypestart[i]++;
+	}
+
+	i = r_ptypestart[t] + r_ptypecount[t];
+	r_ptypecount[t]++;
+	r_numactiveparticles++;
+
+	r_porg[0][i] = p->org[0];
+	r_porg[1][i] = p->org[1];
+	r_porg[2][i] = p->org[2];
+	r_pvel[0][i] = p->vel[0];
+	r_pvel[1][i] = p->vel[1];
+	r_pvel[2][i] = p->vel[2];
+	r_pramp[i] = p->ramp;
+	r_pdie[i] = p->die;
+	r_pcolor[i] = (int)p->color;
 }
 
 /*
@@ -82,7 +168,7 @@ void R_EntityParticles (entity_t *ent)
 {
 	int			count;
 	int			i;
-	particle_t	*p;
+	particle_t	part, *p;
 	float		angle;
 	float		sr, sp, sy, cr, cp, cy;
 	vec3_t		forward;
@@ -97,6 +183,7 @@ for (i=0 ; i<NUMVERTEXNORMALS*3 ; i++)
 avelocities[0][i] = (rand()&255) * 0.01;
 }
 
+	memset (&part, 0, sizeof(part));	// no velocity or ramp
 
 	for (i=0 ; i<NUMVERTEXNORMALS ; i++)
 	{
@@ -114,12 +201,9 @@ avelocities[0][i] = (rand()&255) * 0.01;
 		forward[1] = cp*sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		if (r_numactiveparticles >= r_numparticles)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+		p = &part;
 
 		p->die = cl.time + 0.01;
 		p->color = 0x6f;
@@ -128,6 +212,7 @@ avelocities[0][i] = (rand()&255) * 0.01;
 		p->org[0] = ent->origin[0] + r_avertexnormals[i][0]*dist + forward[0]*beamlength;			
 		p->org[1] = ent->origin[1] + r_avertexnormals[i][1]*dist + forward[1]*beamlength;			
 		p->org[2] = ent->origin[2] + r_avertexnormals[i][2]*dist + forward[2]*beamlength;			
+		R_AddParticle (p);
 	}
 }
 
@@ -139,14 +224,9 @@ R_ClearParticles
 */
 void R_ClearParticles (void)
 {
-	int		i;
-	
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i=0 ;i<r_numparticles ; i++)
-		particles[i].next = &particles[i+1];
-	particles[r_numparticles-1].next = NULL;
+	memset (r_ptypestart, 0, sizeof(r_ptypestart));
+	memset (r_ptypecount, 0, sizeof(r_ptypecount));
+	r_numactiveparticles = 0;
 }
 
 
@@ -156,7 +236,7 @@ void R_ReadPointFile_f (void)
 	vec3_t	org;
 	int		r;
 	int		c;
-	particle_t	*p;
+	particle_t	part, *p;
 	char	name[MAX_OSPATH];
 	
 	sprintf (name,"maps/%s.pts", sv.name);
@@ -177,21 +257,19 @@ void R_ReadPointFile_f (void)
 			break;
 		c++;
 		
-		if (!free_particles)
+		if (r_numactiveparticles >= r_numparticles)
 		{
 			Con_Printf ("Not enough free particles\n");
 			break;
 		}
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+		p = &part;
 		
 		p->die = 99999;
 		p->color = (-c)&15;
 		p->type = pt_static;
 		VectorCopy (vec3_origin, p->vel);
 		VectorCopy (org, p->org);
+		R_AddParticle (p);
 	}
 
 	fclose (f);
@@ -234,16 +312,13 @@ R_ParticleExplosion
 void R_ParticleExplosion (vec3_t org)
 {
 	int			i, j;
-	particle_t	*p;
+	particle_t	part, *p;
 	
 	for (i=0 ; i<1024 ; i++)
 	{
-		if (!free_particles)
+		if (r_numactiveparticles >= r_numparticles)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+		p = &part;
 
 		p->die = cl.time + 5;
 		p->color = ramp1[0];
@@ -266,6 +341,7 @@ void R_ParticleExplosion (vec3_t org)
 				p->vel[j] = (rand()%512)-256;
 			}
 		}
+		R_AddParticle (p);
 	}
 }
 
@@ -278,17 +354,14 @@ R_ParticleExplosion2
 void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 {
 	int			i, j;
-	particle_t	*p;
+	particle_t	part, *p;
 	int			colorMod = 0;
 
 	for (i=0; i<512; i++)
 	{
-		if (!free_particles)
+		if (r_numactiveparticles >= r_numparticles)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+		p = &part;
 
 		p->die = cl.time + 0.3;
 		p->color = colorStart + (colorMod % colorLength);
@@ -300,6 +373,7 @@ void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 			p->org[j] = org[j] + ((rand()%32)-16);
 			p->vel[j] = (rand()%512)-256;
 		}
+		R_AddParticle (p);
 	}
 }
 
@@ -312,16 +386,13 @@ R_BlobExplosion
 void R_BlobExplosion (vec3_t org)
 {
 	int			i, j;
-	particle_t	*p;
+	particle_t	part, *p;
 	
 	for (i=0 ; i<1024 ; i++)
 	{
-		if (!free_particles)
+		if (r_numactiveparticles >= r_numparticles)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+		p = &part;
 
 		p->die = cl.time + 1 + (rand()&8)*0.05;
 
@@ -345,6 +416,7 @@ void R_BlobExplosion (vec3_t org)
 				p->vel[j] = (rand()%512)-256;
 			}
 		}
+		R_AddParticle (p);
 	}
 }
 
@@ -357,16 +429,13 @@ R_RunParticleEffect
 void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 {
 	int			i, j;
-	particle_t	*p;
+	particle_t	part, *p;
 	
 	for (i=0 ; i<count ; i++)
 	{
-		if (!free_particles)
+		if (r_numactiveparticles >= r_numparticles)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+		p = &part;
 
 		if (count == 1024)
 		{	// rocket explosion
@@ -403,6 +472,7 @@ void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 				p->vel[j] = dir[j]*15;// + (rand()%300)-150;
 			}
 		}
+		R_AddParticle (p);
 	}
 }
 
@@ -416,7 +486,7 @@ R_LavaSplash
 void R_LavaSplash (vec3_t org)
 {
 	int			i, j, k;
-	particle_t	*p;
+	particle_t	part, *p;
 	float		vel;
 	vec3_t		dir;
 
@@ -424,12 +494,9 @@ void R_LavaSplash (vec3_t org)
 		for (j=-16 ; j<16 ; j++)
 			for (k=0 ; k<1 ; k++)
 			{
-				if (!free_particles)
+				if (r_numactiveparticles >= r_numparticles)
 					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
+				p = &part;
 		
 				p->die = cl.time + 2 + (rand()&31) * 0.02;
 				p->color = 224 + (rand()&7);
@@ -446,6 +513,7 @@ void R_LavaSplash (vec3_t org)
 				VectorNormalize (dir);						
 				vel = 50 + (rand()&63);
 				VectorScale (dir, vel, p->vel);
+				R_AddParticle (p);
 			}
 }
 
@@ -458,7 +526,7 @@ R_TeleportSplash
 void R_TeleportSplash (vec3_t org)
 {
 	int			i, j, k;
-	particle_t	*p;
+	particle_t	part, *p;
 	float		vel;
 	vec3_t		dir;
 
@@ -466,12 +534,9 @@ void R_TeleportSplash (vec3_t org)
 		for (j=-16 ; j<16 ; j+=4)
 			for (k=-24 ; k<32 ; k+=4)
 			{
-				if (!free_particles)
+				if (r_numactiveparticles >= r_numparticles)
 					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
+				p = &part;
 		
 				p->die = cl.time + 0.2 + (rand()&7) * 0.02;
 				p->color = 7 + (rand()&7);
@@ -488,6 +553,7 @@ void R_TeleportSplash (vec3_t org)
 				VectorNormalize (dir);						
 				vel = 50 + (rand()&63);
 				VectorScale (dir, vel, p->vel);
+				R_AddParticle (p);
 			}
 }
 
@@ -496,7 +562,7 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	vec3_t		vec;
 	float		len;
 	int			j;
-	particle_t	*p;
+	particle_t	part, *p;
 	int			dec;
 	static int	tracercount;
 
@@ -514,12 +580,9 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (r_numactiveparticles >= r_numparticles)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+		p = &part;
 		
 		VectorCopy (vec3_origin, p->vel);
 		p->die = cl.time + 2;
@@ -589,35 +652,144 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 					p->org[j] = start[j] + ((rand()&15)-8);
 				break;
 		}
-		
+		R_AddParticle (p);
 
 		VectorAdd (start, vec, start);
 	}
 }
 
 
+/*
+===============
+R_ProjectParticles
+
+Done once per frame, by whichever of R_MarkParticleZNeeds and
+R_DrawParticles gets there first
+===============
+*/
+static void R_ProjectParticles (void)
+{
+	if (r_pprojectframe == r_framecount)
+		return;
+	r_pprojectframe = r_framecount;
+
+	VectorScale (vright, xscaleshrink, r_pright);
+	VectorScale (vup, yscaleshrink, r_pup);
+	VectorCopy (vpn, r_ppn);
+
+	D_ProjectParticles (r_numactiveparticles, r_porg, r_pdie, cl.time,
+			r_pcolor);
+}
+
+
+/*
+===============
+R_MarkParticleZNeeds
+
+Lets the world only write z under the particles
+===============
+*/
+void R_MarkParticleZNeeds (void)
+{
+	double	time1;
+
+	time1 = Sys_FloatTime ();
+
+	R_ProjectParticles ();
+	D_MarkParticleZNeeds ();
+
+	r_partdrawtime += Sys_FloatTime () - time1;
+}
+
+
 /*
 ===============
 R_DrawParticles
+
+Only draws; R_MoveParticles runs the physics once the view is finished, so
+the particles can be drawn more than once per frame when tiling
+===============
+*/
+void R_DrawParticles (void)
+{
+	double	time1;
+
+	time1 = Sys_FloatTime ();
+
+	D_StartParticles ();
+
+	R_ProjectParticles ();
+	D_DrawParticles ();
+
+	D_EndParticles ();
+
+	r_partdrawtime += Sys_FloatTime () - time1;
+}
+
+
+/*
+===============
+R_RampParticles
+
+Steps the color ramp of a run, killing the particles that run off its end
+===============
+*/
+static void R_RampParticles (int first, int count, float step, float limit,
+	int *ramp)
+{
+	int		i;
+	float	r;
+
+	for (i=first ; i<first+count ; i++)
+	{
+		r = r_pramp[i] + step;
+		r_pramp[i] = r;
+		r_pcolor[i] = ramp[(int)r & 7];
+		r_pdie[i] = r >= limit ? -1 : r_pdie[i];
+	}
+}
+
+
+/*
+===============
+R_AccelParticles
+
+Adds scale times the velocity back into each horizontal component, and
+into z as well if scalez is set
+===============
+*/
+static void R_AccelParticles (int first, int count, float scale,
+	float scalez, float grav)
+{
+	int		i;
+
+	for (i=first ; i<first+count ; i++)
+	{
+		r_pvel[0][i] += r_pvel[0][i] * scale;
+		r_pvel[1][i] += r_pvel[1][i] * scale;
+		r_pvel[2][i] += r_pvel[2][i] * scalez - grav;
+	}
+}
+
+
+/*
+===============
+R_MoveParticles
 ===============
 */
 extern	cvar_t	sv_gravity;
 
-void R_DrawParticles (void)
+void R_MoveParticles (void)
 {
-	particle_t		*p, *kill;
+	int				i, j, t, w;
 	float			grav;
-	int				i;
 	float			time2, time3;
 	float			time1;
 	float			dvel;
 	float			frametime;
-	
-	D_StartParticles ();
+	double			start;
 
-	VectorScale (vright, xscaleshrink, r_pright);
-	VectorScale (vup, yscaleshrink, r_pup);
-	VectorCopy (vpn, r_ppn);
+	start = Sys_FloatTime ();
 
 	frametime = cl.time - cl.oldtime;
 	time3 = frametime * 15;
@@ -625,95 +797,74 @@ void R_DrawParticles (void)
 	time1 = frametime * 5;
 	grav = frametime * sv_gravity.value * 0.05;
 	dvel = 4*frametime;
-	
-	for ( ;; ) 
-	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
-		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
-		}
-		break;
-	}
 
-	for (p=active_particles ; p ; p=p->next)
+// squeeze out the dead, keeping the runs in order
+	w = 0;
+	for (t=0 ; t<PT_NUMTYPES ; t++)
 	{
-		for ( ;; )
+		i = r_ptypestart[t];
+		j = i + r_ptypecount[t];
+		r_ptypestart[t] = w;
+
+		for ( ; i<j ; i++)
 		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
+			if (r_pdie[i] < cl.time)
 				continue;
-			}
-			break;
+			if (w != i)
+				R_CopyParticle (w, i);
+			w++;
 		}
 
-		D_DrawParticle (p);
+		r_ptypecount[t] = w - r_ptypestart[t];
+	}
+	r_numactiveparticles = w;
 
-		p->org[0] += p->vel[0]*frametime;
-		p->org[1] += p->vel[1]*frametime;
-		p->org[2] += p->vel[2]*frametime;
-		
-		switch (p->type)
-		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
+	for (i=0 ; i<w ; i++)
+	{
+		r_porg[0][i] += r_pvel[0][i]*frametime;
+		r_porg[1][i] += r_pvel[1][i]*frametime;
+		r_porg[2][i] += r_pvel[2][i]*frametime;
+	}
 
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+	R_RampParticles (r_ptypestart[pt_fire], r_ptypecount[pt_fire],
+			time1, 6, ramp3);
+	R_AccelParticles (r_ptypestart[pt_fire], r_ptypecount[pt_fire],
+			0, 0, -grav);
 
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] -= p->vel[i]*frametime;
-			p->vel[2] -= grav;
-			break;
+	R_RampParticles (r_ptypestart[pt_explode], r_ptypecount[pt_explode],
+			time2, 8, ramp1);
+	R_AccelParticles (r_ptypestart[pt_explode], r_ptypecount[pt_explode],
+			dvel, dvel, grav);
 
-		case pt_blob:
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+	R_RampParticles (r_ptypestart[pt_explode2], r_ptypecount[pt_explode2],
+			time3, 8, ramp2);
+	R_AccelParticles (r_ptypestart[pt_explode2], r_ptypecount[pt_explode2],
+			-frametime, -frametime, grav);
 
-		case pt_blob2:
-			for (i=0 ; i<2 ; i++)
-				p->vel[i] -= p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+	R_AccelParticles (r_ptypestart[pt_blob], r_ptypecount[pt_blob],
+			dvel, dvel, grav);
+	R_AccelParticles (r_ptypestart[pt_blob2], r_ptypecount[pt_blob2],
+			-dvel, 0, grav);
 
-		case pt_grav:
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
-		}
-	}
+// pt_grav and pt_slowgrav are neighbouring runs
+	R_AccelParticles (r_ptypestart[pt_grav],
+			r_ptypecount[pt_grav] + r_ptypecount[pt_slowgrav], 0, 0, grav);
 
-	D_EndParticles ();
+	r_partmovetime += Sys_FloatTime () - start;
 }
 
+
+/*
+===============
+R_PrintParticleStats
+===============
+*/
+void R_PrintParticleStats (void)
+{
+	Con_Printf ("%4i particles %4i visible %5.2f ms move %5.2f ms draw\n",
+			r_numactiveparticles, d_numparticles, r_partmovetime * 1000,
+			r_partdrawtime * 1000);
+
+	r_partmovetime = 0;
+	r_partdrawtime = 0;
+}
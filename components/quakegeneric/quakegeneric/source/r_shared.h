@@ -54,17 +54,17 @@ extern int		r_drawnpolycount;
 extern cvar_t	r_clearcolor;
 
 extern int	sintable[SIN_BUFFER_SIZE];
-extern int	intsintable[SIN_BUFFER_SIZE];
+extern byte	intsintable[SIN_BUFFER_SIZE];
 
 extern	vec3_t	vup, base_vup;
 extern	vec3_t	vpn, base_vpn;
 extern	vec3_t	vright, base_vright;
 extern	entity_t		*currententity;
 
-#define NUMSTACKEDGES		2400
-#define	MINEDGES			NUMSTACKEDGES
-#define NUMSTACKSURFACES	800
-#define MINSURFACES			NUMSTACKSURFACES
+// smallest pools R_NewMap will allocate; maps that need more are sized from
+// their recorded high-water marks
+#define	MINEDGES			2400
+#define MINSURFACES			800
 #define	MAXSPANS			3000
 
 // !!! if this is changed, it must be changed in asm_draw.h too !!!
@@ -123,9 +123,6 @@ extern void TransformVector (vec3_t in, vec3_t out);
 extern void SetUpForLineScan(fixed8_t startvertu, fixed8_t startvertv,
 	fixed8_t endvertu, fixed8_t endvertv);
 
-extern int	r_skymade;
-extern void R_MakeSky (void);
-
 extern int	ubasestep, errorterm, erroradjustup, erroradjustdown;
 
 // flags in finalvert_t.flags
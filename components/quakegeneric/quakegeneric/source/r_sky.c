@@ -32,18 +32,16 @@ float		skytime;
 
 byte		*r_skysource;
 
-int r_skymade;
 int r_skydirect;		// not used?
 
 
 // TODO: clean up these routines
 
-EXT_RAM_BSS_ATTR byte	bottomsky[128*131];
-EXT_RAM_BSS_ATTR byte	bottommask[128*131];
-EXT_RAM_BSS_ATTR byte	newsky[128*256];	// newsky and topsky both pack in here, 128 bytes
-							//  of newsky on the left of each scan, 128 bytes
-							//  of topsky on the right, because the low-level
-							//  drawers need 256-byte scan widths
+EXT_RAM_BSS_ATTR byte	skylayers[128*256];	// both sky layers, 128 bytes of the
+							//  masked front layer on the left of each scan
+							//  (0 where it's clear), 128 bytes of the back
+							//  layer on the right; D_DrawSkyScans8 scrolls
+							//  and combines them as it draws
 
 
 /*
@@ -55,82 +53,15 @@ A sky texture is 256*128, with the right side being a masked overlay
 */
 void R_InitSky (texture_t *mt)
 {
-	int			i, j;
+	int			i;
 	byte		*src;
 
 	src = (byte *)mt + mt->offsets[0];
 
 	for (i=0 ; i<128 ; i++)
-	{
-		for (j=0 ; j<128 ; j++)
-		{
-			newsky[(i*256) + j + 128] = src[i*256 + j + 128];
-		}
-	}
+		memcpy (&skylayers[i*256], &src[i*256], 256);
 
-	for (i=0 ; i<128 ; i++)
-	{
-		for (j=0 ; j<131 ; j++)
-		{
-			if (src[i*256 + (j & 0x7F)])
-			{
-				bottomsky[(i*131) + j] = src[i*256 + (j & 0x7F)];
-				bottommask[(i*131) + j] = 0;
-			}
-			else
-			{
-				bottomsky[(i*131) + j] = 0;
-				bottommask[(i*131) + j] = 0xff;
-			}
-		}
-	}
-	
-	r_skysource = newsky;
-}
-
-
-/*
-=================
-R_MakeSky
-=================
-*/
-void R_MakeSky (void)
-{
-	int			x, y;
-	int			ofs, baseofs;
-	int			xshift, yshift;
-	unsigned	*pnewsky;
-	static int	xlast = -1, ylast = -1;
-
-	xshift = skytime*skyspeed;
-	yshift = skytime*skyspeed;
-
-	if ((xshift == xlast) && (yshift == ylast))
-		return;
-
-	xlast = xshift;
-	ylast = yshift;
-	
-	pnewsky = (unsigned *)&newsky[0];
-
-	for (y=0 ; y<SKYSIZE ; y++)
-	{
-		baseofs = ((y+yshift) & SKYMASK) * 131;
-
-		for (x=0 ; x<SKYSIZE ; x++)
-		{
-			ofs = baseofs + ((x+xshift) & SKYMASK);
-
-			*(byte *)pnewsky = (*((byte *)pnewsky + 128) &
-						*(byte *)&bottommask[ofs]) |
-						*(byte *)&bottomsky[ofs];
-			pnewsky = (unsigned *)((byte *)pnewsky + 1);
-		}
-
-		pnewsky += 128 / sizeof (unsigned);
-	}
-
-	r_skymade = 1;
+	r_skysource = skylayers;
 }
 
 
@@ -142,33 +73,26 @@ R_GenSkyTile
 void R_GenSkyTile (void *pdest)
 {
 	int			x, y;
-	int			ofs, baseofs;
 	int			xshift, yshift;
-	unsigned	*pnewsky;
-	unsigned	*pd;
+	byte		*pd, *front, *back;
 
 	xshift = skytime*skyspeed;
 	yshift = skytime*skyspeed;
 
-	pnewsky = (unsigned *)&newsky[0];
-	pd = (unsigned *)pdest;
+	pd = (byte *)pdest;
 
 	for (y=0 ; y<SKYSIZE ; y++)
 	{
-		baseofs = ((y+yshift) & SKYMASK) * 131;
+		front = &skylayers[((y+yshift) & SKYMASK) * 256];
+		back = &skylayers[y*256 + 128];
 
 		for (x=0 ; x<SKYSIZE ; x++)
 		{
-			ofs = baseofs + ((x+xshift) & SKYMASK);
-
-			*(byte *)pd = (*((byte *)pnewsky + 128) &
-						*(byte *)&bottommask[ofs]) |
-						*(byte *)&bottomsky[ofs];
-			pnewsky = (unsigned *)((byte *)pnewsky + 1);
-			pd = (unsigned *)((byte *)pd + 1);
+			*pd = front[(x+xshift) & SKYMASK];
+			if (!*pd)
+				*pd = back[x];
+			pd++;
 		}
-
-		pnewsky += 128 / sizeof (unsigned);
 	}
 }
 
@@ -191,9 +115,5 @@ void R_SetSkyFrame (void)
 	temp = SKYSIZE * s1 * s2;
 
 	skytime = cl.time - ((int)(cl.time / temp) * temp);
-	
-
-	r_skymade = 0;
 }
 
-
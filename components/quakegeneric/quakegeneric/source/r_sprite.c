@@ -26,6 +26,9 @@ static int				clip_current;
 static vec5_t			clip_verts[2][MAXWORKINGVERTS];
 static int				sprite_width, sprite_height;
 
+// axes closer than this to the view's count as parallel (about 0.25 degrees)
+#define SPRITE_PARALLEL_EPSILON	0.99999
+
 spritedesc_t			r_spritedesc;
 	
 
@@ -128,6 +131,50 @@ int R_ClipSpriteFace (int nump, clipplane_t *pclipplane)
 }
 
 
+/*
+================
+R_DrawSpriteRect
+
+A sprite whose axes line up with the view's is a flat rectangle at a single
+depth on screen, so it's drawn as one without clipping or gradients; returns
+false if the sprite isn't like that
+================
+*/
+qboolean R_DrawSpriteRect (void)
+{
+	float			zi, xs, ys;
+	vec3_t			local, transformed;
+	mspriteframe_t	*pframe;
+
+	if ((DotProduct (r_spritedesc.vright, vright) < SPRITE_PARALLEL_EPSILON) ||
+		(DotProduct (r_spritedesc.vup, vup) < SPRITE_PARALLEL_EPSILON))
+	{
+		return false;
+	}
+
+	VectorSubtract (r_entorigin, r_origin, local);
+	TransformVector (local, transformed);
+
+	if (transformed[2] < NEAR_CLIP)
+		return false;
+
+	pframe = r_spritedesc.pspriteframe;
+
+	zi = 1.0 / transformed[2];
+	xs = xscale * zi;
+	ys = yscale * zi;
+
+	r_spritedesc.nearzi = zi;
+	r_spritedesc.rectleft = xcenter + xs * (transformed[0] + pframe->left);
+	r_spritedesc.rectright = xcenter + xs * (transformed[0] + pframe->right);
+	r_spritedesc.recttop = ycenter - ys * (transformed[1] + pframe->up);
+	r_spritedesc.rectbottom = ycenter - ys * (transformed[1] + pframe->down);
+
+	D_DrawSpriteRect ();
+	return true;
+}
+
+
 /*
 ================
 R_SetupAndDrawSprite
@@ -147,6 +194,9 @@ void R_SetupAndDrawSprite ()
 	if (dot >= 0)
 		return;
 
+	if (r_spriterect.value && R_DrawSpriteRect ())
+		return;
+
 // build the sprite poster in worldspace
 	VectorScale (r_spritedesc.vright, r_spritedesc.pspriteframe->right, right);
 	VectorScale (r_spritedesc.vup, r_spritedesc.pspriteframe->up, up);
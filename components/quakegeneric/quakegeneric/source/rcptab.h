@@ -0,0 +1,85 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// table of reciprocals 2**63 / m for m = 2**31 + (i + 0.5) * 2**23,
+// i = 0...255, the starting guesses for D_FixedZ
+0xff803fe0, 0xfe823ca5, 0xfd863087, 0xfc8c15b4,
+0xfb93e673, 0xfa9d9d20, 0xf9a9342d, 0xf8b6a622,
+0xf7c5ed9c, 0xf6d7054e, 0xf5e9e7fc, 0xf4fe9082,
+0xf414f9cd, 0xf32d1edf, 0xf246facb, 0xf16288b9,
+0xf07fc3e0, 0xef9ea78c, 0xeebf2f19, 0xede155f4,
+0xed05179c, 0xec2a6fa0, 0xeb51599f, 0xea79d14a,
+0xe9a3d25e, 0xe8cf58ab, 0xe7fc600e, 0xe72ae475,
+0xe65ae1db, 0xe58c544a, 0xe4bf37d9, 0xe3f388af,
+0xe32942ff, 0xe260630a, 0xe198e51f, 0xe0d2c599,
+0xe00e00e0, 0xdf4a9368, 0xde8879b3, 0xddc7b04c,
+0xdd0833ce, 0xdc4a00dc, 0xdb8d1427, 0xdad16a6b,
+0xda17006d, 0xd95dd300, 0xd8a5deff, 0xd7ef2151,
+0xd73996e9, 0xd6853cc1, 0xd5d20fdf, 0xd5200d52,
+0xd46f3234, 0xd3bf7ba8, 0xd310e6da, 0xd2637100,
+0xd1b71759, 0xd10bd72c, 0xd061adc9, 0xcfb8988c,
+0xcf1094d4, 0xce69a00d, 0xcdc3b7a9, 0xcd1ed924,
+0xcc7b01ff, 0xcbd82fc7, 0xcb36600d, 0xca95906c,
+0xc9f5be85, 0xc956e803, 0xc8b90a96, 0xc81c23f5,
+0xc78031e0, 0xc6e5321d, 0xc64b2278, 0xc5b200c6,
+0xc519cae0, 0xc4827ea8, 0xc3ec1a05, 0xc3569ae6,
+0xc2c1ff3d, 0xc22e4506, 0xc19b6a42, 0xc1096cf6,
+0xc0784b2f, 0xbfe80300, 0xbf589280, 0xbec9f7cd,
+0xbe3c310c, 0xbdaf3c63, 0xbd231803, 0xbc97c21e,
+0xbc0d38ee, 0xbb837ab1, 0xbafa85a9, 0xba725820,
+0xb9eaf063, 0xb9644cc4, 0xb8de6b99, 0xb8594b40,
+0xb7d4ea19, 0xb7514689, 0xb6ce5ef9, 0xb64c31d9,
+0xb5cabd9a, 0xb54a00b5, 0xb4c9f9a5, 0xb44aa6e9,
+0xb3cc0706, 0xb34e1884, 0xb2d0d9ef, 0xb25449d7,
+0xb1d866d1, 0xb15d2f75, 0xb0e2a260, 0xb068be31,
+0xafef818c, 0xaf76eb18, 0xaefef982, 0xae87ab76,
+0xae10ffa9, 0xad9af4d0, 0xad2589a3, 0xacb0bce1,
+0xac3c8d4a, 0xabc8f9a0, 0xab5600ab, 0xaae3a136,
+0xaa71da0d, 0xaa00aa01, 0xa9900fe6, 0xa9200a92,
+0xa8b098e0, 0xa841b9ad, 0xa7d36bd7, 0xa765ae43,
+0xa6f87fd6, 0xa68bdf79, 0xa61fcc16, 0xa5b4449d,
+0xa54947fd, 0xa4ded52c, 0xa474eb1f, 0xa40b88d0,
+0xa3a2ad39, 0xa33a575a, 0xa2d28634, 0xa26b38c8,
+0xa2046e1f, 0xa19e253f, 0xa1385d35, 0xa0d3150c,
+0xa06e4bd4, 0xa00a00a0, 0x9fa63284, 0x9f42e095,
+0x9ee009ee, 0x9e7dada9, 0x9e1bcae3, 0x9dba60bb,
+0x9d596e54, 0x9cf8f2d1, 0x9c98ed58, 0x9c395d10,
+0x9bda4124, 0x9b7b98c0, 0x9b1d6311, 0x9abf9f48,
+0x9a624c97, 0x9a056a31, 0x99a8f74c, 0x994cf320,
+0x98f15ce7, 0x989633db, 0x983b773b, 0x97e12644,
+0x97874039, 0x972dc45b, 0x96d4b1ef, 0x967c083b,
+0x9623c686, 0x95cbec1b, 0x95747844, 0x951d6a4d,
+0x94c6c187, 0x94707d3f, 0x941a9cc8, 0x93c51f75,
+0x9370049c, 0x931b4b91, 0x92c6f3ac, 0x9272fc48,
+0x921f64bf, 0x91cc2c6c, 0x917952ae, 0x9126d6e5,
+0x90d4b86f, 0x9082f6b0, 0x9031910a, 0x8fe086e2,
+0x8f8fd7a0, 0x8f3f82a8, 0x8eef8766, 0x8e9fe542,
+0x8e509ba8, 0x8e01aa05, 0x8db30fc6, 0x8d64cc5c,
+0x8d16df35, 0x8cc947c5, 0x8c7c057d, 0x8c2f17d2,
+0x8be27e39, 0x8b963829, 0x8b4a451a, 0x8afea483,
+0x8ab355e0, 0x8a6858ab, 0x8a1dac60, 0x89d3507d,
+0x89894480, 0x893f87e8, 0x88f61a37, 0x88acfaee,
+0x8864298f, 0x881ba59e, 0x87d36ea0, 0x878b841a,
+0x8743e595, 0x86fc9296, 0x86b58aa8, 0x866ecd53,
+0x86285a23, 0x85e230a3, 0x859c5060, 0x8556b8e7,
+0x851169c7, 0x84cc6290, 0x8487a2d1, 0x84432a1b,
+0x83fef802, 0x83bb0c18, 0x837765f0, 0x83340520,
+0x82f0e93d, 0x82ae11de, 0x826b7e99, 0x82292f08,
+0x81e722c2, 0x81a55963, 0x8163d283, 0x81228dbf,
+0x80e18ab3, 0x80a0c8fb, 0x80604836, 0x80200802,
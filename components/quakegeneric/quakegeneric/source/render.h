@@ -67,6 +67,14 @@ typedef struct entity_s
 	struct mnode_s			*topnode;		// for bmodels, first world node
 											//  that splits bmodel, or NULL if
 											//  not split
+
+// bmodel placement in the world BSP, kept while the entity doesn't move
+	struct mnode_s			*placednode;
+	struct model_s			*placedmodel;
+	vec3_t					placedorigin;
+	int						placedmap;
+	int						placedvisframe;	// r_visframecount placedvisible
+	qboolean				placedvisible;	//  was worked out for
 } entity_t;
 
 // !!! if this is changed, it must be changed in asm_draw.h too !!!
@@ -38,6 +38,7 @@ cvar_t		scr_showram = {"showram","1"};
 cvar_t		scr_showturtle = {"showturtle","0"};
 cvar_t		scr_showpause = {"showpause","1"};
 cvar_t		scr_printspeed = {"scr_printspeed","8"};
+cvar_t		scr_overlaycache = {"scr_overlaycache","1"};
 
 qboolean	scr_initialized;		// ready to draw
 
@@ -63,6 +64,7 @@ qboolean	scr_skipupdate;
 qboolean	block_drawing;
 
 void SCR_ScreenShot_f (void);
+static void SCR_DirtyOverlay (void);
 
 /*
 ===============================================================================
@@ -120,6 +122,7 @@ void SCR_EraseCenterString (void)
 
 	scr_copytop = 1;
 	Draw_TileClear (0, y,vid.width, 8*scr_erase_lines);
+	SCR_DirtyOverlay ();
 }
 
 void SCR_DrawCenterString (void)
@@ -139,6 +142,8 @@ void SCR_DrawCenterString (void)
 	scr_erase_center = 0;
 	start = scr_centerstring;
 
+	SCR_DirtyOverlay ();
+
 	if (scr_center_lines <= 4)
 		y = vid.height*0.35;
 	else
@@ -321,6 +326,7 @@ void SCR_Init (void)
 	Cvar_RegisterVariable (&scr_showpause);
 	Cvar_RegisterVariable (&scr_centertime);
 	Cvar_RegisterVariable (&scr_printspeed);
+	Cvar_RegisterVariable (&scr_overlaycache);
 
 //
 // register our commands
@@ -351,6 +357,7 @@ void SCR_DrawRam (void)
 	if (!r_cache_thrash)
 		return;
 
+	SCR_DirtyOverlay ();
 	Draw_Pic (scr_vrect.x+32, scr_vrect.y, scr_ram);
 }
 
@@ -376,6 +383,7 @@ void SCR_DrawTurtle (void)
 	if (count < 3)
 		return;
 
+	SCR_DirtyOverlay ();
 	Draw_Pic (scr_vrect.x, scr_vrect.y, scr_turtle);
 }
 
@@ -391,6 +399,7 @@ void SCR_DrawNet (void)
 	if (cls.demoplayback)
 		return;
 
+	SCR_DirtyOverlay ();
 	Draw_Pic (scr_vrect.x+64, scr_vrect.y, scr_net);
 }
 
@@ -410,6 +419,7 @@ void SCR_DrawPause (void)
 		return;
 
 	pic = Draw_CachePic ("gfx/pause.lmp");
+	SCR_DirtyOverlay ();
 	Draw_Pic ( (vid.width - pic->width)/2, 
 		(vid.height - 48 - pic->height)/2, pic);
 }
@@ -438,6 +448,176 @@ void SCR_DrawLoading (void)
 //=============================================================================
 
 
+/*
+===============================================================================
+
+OVERLAY CACHE
+
+The console, and menus drawn over it, are opaque from the top of the screen
+down to a given line, and mostly the same from one frame to the next.  Each
+page remembers which overlay it last got; a page that still holds the one
+due, with nothing drawn over it since, is left alone.  Otherwise the last
+overlay drawn is kept in scr_ovlcache and copied back while it stays current,
+so only a change costs a real draw.
+
+An overlay is identified by its draw function, its height, and a key from
+Con_DrawKey or M_DrawKey.
+
+===============================================================================
+*/
+
+#define	MAX_OVERLAYPAGES	4
+
+typedef struct
+{
+	void	(*draw) (void);		// NULL if nothing known to be there
+	int		lines;
+	int		key;
+} overlay_t;
+
+typedef struct
+{
+	byte		*buffer;
+	overlay_t	overlay;	// what its top lines hold
+	int			lines;		// where the last overlay ended, -1 if none
+} ovlpage_t;
+
+static ovlpage_t	scr_ovlpages[MAX_OVERLAYPAGES];
+static int			scr_ovlnextpage;
+static ovlpage_t	*scr_ovlpage;		// the page being drawn
+
+static byte			*scr_ovlcache;		// vid.conwidth * vid.conheight
+static overlay_t	scr_ovlcached;
+
+/*
+==================
+SCR_BeginOverlayPage
+
+Finds the record for the page about to be drawn
+==================
+*/
+static void SCR_BeginOverlayPage (void)
+{
+	int		i;
+
+	for (i=0 ; i<MAX_OVERLAYPAGES ; i++)
+	{
+		if (scr_ovlpages[i].buffer == vid.buffer)
+		{
+			scr_ovlpage = &scr_ovlpages[i];
+			return;
+		}
+	}
+
+	scr_ovlpage = &scr_ovlpages[scr_ovlnextpage++ % MAX_OVERLAYPAGES];
+	scr_ovlpage->buffer = vid.buffer;
+	scr_ovlpage->overlay.draw = NULL;
+	scr_ovlpage->lines = -1;
+}
+
+/*
+==================
+SCR_DirtyOverlay
+
+Something other than the overlay has been drawn into its lines
+==================
+*/
+static void SCR_DirtyOverlay (void)
+{
+	if (scr_ovlpage)
+		scr_ovlpage->overlay.draw = NULL;
+}
+
+/*
+==================
+SCR_ClearOverlay
+
+There's no overlay on the page any more, or it can't be told apart from
+whatever else has been drawn
+==================
+*/
+static void SCR_ClearOverlay (void)
+{
+	if (scr_ovlpage)
+	{
+		scr_ovlpage->overlay.draw = NULL;
+		scr_ovlpage->lines = -1;
+	}
+}
+
+/*
+==================
+SCR_OverlayLines
+
+Returns the line the last overlay drawn into this page ended at, -1 if none
+==================
+*/
+static int SCR_OverlayLines (void)
+{
+	if (!scr_ovlpage || !scr_overlaycache.value)
+		return -1;
+	return scr_ovlpage->lines;
+}
+
+/*
+==================
+SCR_DrawOverlay
+
+Draws, restores or keeps the overlay in lines 0 to lines-1
+==================
+*/
+static void SCR_DrawOverlay (void (*draw) (void), int lines, int key)
+{
+	overlay_t	*o;
+	byte		*src, *dest;
+	int			y;
+
+	o = &scr_ovlpage->overlay;
+
+	if (!scr_overlaycache.value || lines > vid.conheight)
+	{
+		SCR_ClearOverlay ();
+		draw ();
+		return;
+	}
+
+	if (o->draw == draw && o->lines == lines && o->key == key)
+		return;		// still on the page
+
+	if (scr_ovlcached.draw == draw && scr_ovlcached.lines == lines
+	&& scr_ovlcached.key == key)
+	{
+		src = scr_ovlcache;
+		dest = vid.conbuffer;
+		for (y=0 ; y<lines ; y++, src += vid.conwidth, dest += vid.conrowbytes)
+			memcpy (dest, src, vid.conwidth);
+	}
+	else
+	{
+		draw ();
+
+		if (!scr_ovlcache)
+			scr_ovlcache = malloc (vid.conwidth * vid.conheight);
+
+		if (scr_ovlcache)
+		{
+			src = vid.conbuffer;
+			dest = scr_ovlcache;
+			for (y=0 ; y<lines ; y++, src += vid.conrowbytes, dest += vid.conwidth)
+				memcpy (dest, src, vid.conwidth);
+
+			scr_ovlcached.draw = draw;
+			scr_ovlcached.lines = lines;
+			scr_ovlcached.key = key;
+		}
+	}
+
+	o->draw = draw;
+	o->lines = lines;
+	o->key = key;
+	scr_ovlpage->lines = lines;
+}
+
 /*
 ==================
 SCR_SetUpToDrawConsole
@@ -479,19 +659,35 @@ void SCR_SetUpToDrawConsole (void)
 
 	if (clearconsole++ < vid.numpages)
 	{
-		scr_copytop = 1;
-		Draw_TileClear (0,(int)scr_con_current,vid.width, vid.height - (int)scr_con_current);
-		Sbar_Changed ();
+	// nothing to uncover if the console ended at the same line last time
+	// this page was drawn
+		if (SCR_OverlayLines () != (int)scr_con_current)
+		{
+			scr_copytop = 1;
+			Draw_TileClear (0,(int)scr_con_current,vid.width, vid.height - (int)scr_con_current);
+			Sbar_Changed ();
+		}
 	}
 	else if (clearnotify++ < vid.numpages)
 	{
 		scr_copytop = 1;
 		Draw_TileClear (0,0,vid.width, con_notifylines);
+		SCR_DirtyOverlay ();
 	}
 	else
 		con_notifylines = 0;
 }
 	
+/*
+==================
+SCR_DrawConsoleText
+==================
+*/
+static void SCR_DrawConsoleText (void)
+{
+	Con_DrawConsole (scr_con_current, true);
+}
+
 /*
 ==================
 SCR_DrawConsole
@@ -502,7 +698,8 @@ void SCR_DrawConsole (void)
 	if (scr_con_current)
 	{
 		scr_copyeverything = 1;
-		Con_DrawConsole (scr_con_current, true);
+		SCR_DrawOverlay (SCR_DrawConsoleText, (int)scr_con_current,
+				Con_DrawKey ((int)scr_con_current));
 		clearconsole = 0;
 	}
 	else
@@ -810,6 +1007,7 @@ void SCR_UpdateScreen (void)
 	static float	oldscr_viewsize;
 	static float	oldlcd_x;
 	vrect_t		vrect;
+	qboolean	menuover;
 	
 	if (scr_skipupdate || block_drawing)
 		return;
@@ -872,32 +1070,46 @@ void SCR_UpdateScreen (void)
 //
 	D_EnableBackBufferAccess ();	// of all overlay stuff if drawing directly
 
-	if (scr_fullupdate++ < vid.numpages)
-	{	// clear the entire screen
-		scr_copyeverything = 1;
-		Draw_TileClear (0,0,vid.width,vid.height);
-		Sbar_Changed ();
-	}
+	SCR_BeginOverlayPage ();
 
 	pconupdate = NULL;
 
-
 	SCR_SetUpToDrawConsole ();
 	SCR_EraseCenterString ();
 
+// a menu over the console paints the whole screen opaquely
+	menuover = scr_con_current && M_DrawKey ()
+			&& !scr_drawdialog && !scr_drawloading;
+
+	if (scr_fullupdate++ < vid.numpages && !menuover)
+	{	// clear the entire screen
+		scr_copyeverything = 1;
+		Draw_TileClear (0,0,vid.width,vid.height);
+		Sbar_Changed ();
+		SCR_ClearOverlay ();
+	}
+
 	D_DisableBackBufferAccess ();	// for adapters that can't stay mapped in
 									//  for linear writes all the time
 
-	VID_LockBuffer ();
+// the refresh is hidden under a menu over the console
+	if (!menuover)
+	{
+		VID_LockBuffer ();
+
+		V_RenderView ();
 
-	V_RenderView ();
+		VID_UnlockBuffer ();
 
-	VID_UnlockBuffer ();
+		if (!con_forcedup)
+			SCR_DirtyOverlay ();
+	}
 
 	D_EnableBackBufferAccess ();	// of all overlay stuff if drawing directly
 
 	if (scr_drawdialog)
 	{
+		SCR_ClearOverlay ();
 		Sbar_Draw ();
 		Draw_FadeScreen ();
 		SCR_DrawNotifyString ();
@@ -905,32 +1117,49 @@ void SCR_UpdateScreen (void)
 	}
 	else if (scr_drawloading)
 	{
+		SCR_ClearOverlay ();
 		SCR_DrawLoading ();
 		Sbar_Draw ();
 	}
 	else if (cl.intermission == 1 && key_dest == key_game)
 	{
+		SCR_ClearOverlay ();
 		Sbar_IntermissionOverlay ();
 	}
 	else if (cl.intermission == 2 && key_dest == key_game)
 	{
+		SCR_ClearOverlay ();
 		Sbar_FinaleOverlay ();
 		SCR_CheckDrawCenterString ();
 	}
 	else if (cl.intermission == 3 && key_dest == key_game)
 	{
+		SCR_ClearOverlay ();
 		SCR_CheckDrawCenterString ();
 	}
+	else if (menuover)
+	{
+		SCR_CheckDrawCenterString ();	// only to run down its timer
+		scr_copyeverything = 1;
+		scr_fullupdate = 0;		// uncover everything once the menu goes
+		SCR_DrawOverlay (M_Draw, vid.height, M_DrawKey ());
+	}
 	else
 	{
-		SCR_DrawRam ();
-		SCR_DrawNet ();
-		SCR_DrawTurtle ();
-		SCR_DrawPause ();
+		if (scr_con_current < vid.height)
+		{	// all hidden under a full console
+			SCR_DrawRam ();
+			SCR_DrawNet ();
+			SCR_DrawTurtle ();
+			SCR_DrawPause ();
+		}
 		SCR_CheckDrawCenterString ();
 		Sbar_Draw ();
 		SCR_DrawConsole ();
 		M_Draw ();
+
+		if (!scr_con_current)
+			SCR_ClearOverlay ();	// nothing of it left on the page
 	}
 
 	D_DisableBackBufferAccess ();	// for adapters that can't stay mapped in
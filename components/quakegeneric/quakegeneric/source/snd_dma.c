@@ -38,6 +38,7 @@ void S_StopAllSoundsC(void);
 
 channel_t   channels[MAX_CHANNELS];
 int			total_channels;
+int			snd_chanstart[MAX_CHANNELS];
 
 int				snd_blocked = 0;
 static qboolean	snd_ambient = 1;
@@ -74,6 +75,7 @@ cvar_t volume = {"volume", "0.7", true};
 cvar_t nosound = {"nosound", "0"};
 cvar_t precache = {"precache", "1"};
 cvar_t loadas8bit = {"loadas8bit", "0"};
+cvar_t snd_storage = {"snd_storage", "2"};
 cvar_t bgmbuffer = {"bgmbuffer", "4096"};
 cvar_t ambient_level = {"ambient_level", "0.3"};
 cvar_t ambient_fade = {"ambient_fade", "100"};
@@ -180,11 +182,13 @@ void S_Init (void)
 	Cmd_AddCommand("stopsound", S_StopAllSoundsC);
 	Cmd_AddCommand("soundlist", S_SoundList);
 	Cmd_AddCommand("soundinfo", S_SoundInfo_f);
+	Cmd_AddCommand("snd_mixbench", SND_MixBench_f);
 
 	Cvar_RegisterVariable(&nosound);
 	Cvar_RegisterVariable(&volume);
 	Cvar_RegisterVariable(&precache);
 	Cvar_RegisterVariable(&loadas8bit);
+	Cvar_RegisterVariable(&snd_storage);
 	Cvar_RegisterVariable(&bgmvolume);
 	Cvar_RegisterVariable(&bgmbuffer);
 	Cvar_RegisterVariable(&ambient_level);
@@ -206,6 +210,9 @@ void S_Init (void)
 	S_Startup ();
 
 	SND_InitScaletable ();
+#ifdef SND_MIXTHREAD
+	S_InitMixThread ();
+#endif
 
 	known_sfx = Hunk_AllocName (MAX_SFX*sizeof(sfx_t), "sfx_t");
 	num_sfx = 0;
@@ -493,6 +500,7 @@ void S_StartSound(int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float f
 	}
 
 	target_chan->sfx = sfx;
+	snd_chanstart[target_chan - channels]++;
 	target_chan->pos = 0.0;
     target_chan->end = paintedtime + sc->length;	
 
@@ -547,8 +555,14 @@ void S_StopAllSounds(qboolean clear)
 
 	Q_memset(channels, 0, MAX_CHANNELS * sizeof(channel_t));
 
+#ifdef SND_MIXTHREAD
+// silence the audio task now rather than at the next S_Update, which may be
+// a whole level load away; the buffer is its own to clear
+	S_PublishChannels ();
+#else
 	if (clear)
 		S_ClearBuffer ();
+#endif
 }
 
 void S_StopAllSoundsC (void)
@@ -645,6 +659,7 @@ void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
 	}
 	
 	ss->sfx = sfx;
+	snd_chanstart[ss - channels]++;
 	VectorCopy (origin, ss->origin);
 	ss->master_vol = vol;
 	ss->dist_mult = (attenuation/64) / sound_nominal_clip_dist;
@@ -656,6 +671,44 @@ void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
 
 //=============================================================================
 
+#ifdef SND_MIXTHREAD
+/*
+===================
+S_RetireChannels
+
+The audio task paints its own copies of the channels, so the ones here never
+reach their end by being painted. Catch the dynamic channels up with
+paintedtime instead, so that finished sounds free their channel for
+SND_PickChannel and looping ones keep a sensible end.
+===================
+*/
+static void S_RetireChannels (void)
+{
+	int			i, now;
+	channel_t	*ch;
+	sfxcache_t	*sc;
+
+	now = paintedtime;
+
+	ch = channels + NUM_AMBIENTS;
+	for (i=NUM_AMBIENTS ; i<NUM_AMBIENTS + MAX_DYNAMIC_CHANNELS ; i++, ch++)
+	{
+		if (!ch->sfx || ch->end > now)
+			continue;
+
+		sc = Cache_Check (&ch->sfx->cache);
+		if (!sc || sc->loopstart < 0 || sc->loopstart >= sc->length)
+		{
+			ch->sfx = NULL;
+			continue;
+		}
+
+		while (ch->end <= now)
+			ch->end += sc->length - sc->loopstart;
+	}
+}
+#endif
+
 /*
 ===================
 S_UpdateAmbientSounds
@@ -736,6 +789,10 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 // update general area ambient sound sources
 	S_UpdateAmbientSounds ();
 
+#ifdef SND_MIXTHREAD
+	S_RetireChannels ();
+#endif
+
 	combine = NULL;
 
 // update spatialization for static and dynamic sounds	
@@ -803,8 +860,13 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 		Con_Printf ("----(%i)----\n", total);
 	}
 
+#ifdef SND_MIXTHREAD
+// hand the channels to the audio task, which does the mixing
+	S_PublishChannels ();
+#else
 // mix some sound
 	S_Update_();
+#endif
 }
 
 void GetSoundtime(void)
@@ -848,9 +910,11 @@ void S_ExtraUpdate (void)
 	IN_Accumulate ();
 #endif
 
+#ifndef SND_MIXTHREAD	// otherwise the audio task keeps itself fed
 	if (snd_noextraupdate.value)
 		return;		// don't pollute timings
 	S_Update_();
+#endif
 }
 
 void S_Update_(void)
@@ -943,23 +1007,34 @@ void S_SoundList(void)
 	int		i;
 	sfx_t	*sfx;
 	sfxcache_t	*sc;
-	int		size, total;
+	int		size, total, resampled;
+	int		formatbytes[SFX_NUMFORMATS];
+	static char	*formatnames[SFX_NUMFORMATS] = {"pcm8", "pcm16", "adpcm"};
 
 	total = 0;
+	resampled = 0;
+	memset (formatbytes, 0, sizeof(formatbytes));
 	for (sfx=known_sfx, i=0 ; i<num_sfx ; i++, sfx++)
 	{
 		sc = Cache_Check (&sfx->cache);
 		if (!sc)
 			continue;
-		size = sc->length*sc->width*(sc->stereo+1);
+		size = sc->bytes;
 		total += size;
+		formatbytes[sc->format] += size;
+	// what snd_storage 0 would have cached it in
+		resampled += sc->length * (sc->format == SFX_PCM8 ? 1 : 2);
 		if (sc->loopstart >= 0)
 			Con_Printf ("L");
 		else
 			Con_Printf (" ");
-		Con_Printf("(%2db) %6i : %s\n",sc->width*8,  size, sfx->name);
+		Con_Printf("(%-5s %5i) %6i : %s\n", formatnames[sc->format], sc->speed,
+				size, sfx->name);
 	}
 	Con_Printf ("Total resident: %i\n", total);
+	for (i=0 ; i<SFX_NUMFORMATS ; i++)
+		Con_Printf ("  %-5s %7i\n", formatnames[i], formatbytes[i]);
+	Con_Printf ("resampled to %i Hz: %i\n", shm ? shm->speed : 0, resampled);
 }
 
 
@@ -56,6 +56,10 @@ void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	else
 		sc->width = inwidth;
 	sc->stereo = 0;
+	sc->format = sc->width == 1 ? SFX_PCM8 : SFX_PCM16;
+	sc->step = 1<<16;
+	sc->samples = outcount;
+	sc->bytes = outcount * sc->width;
 
 // resample / decimate to the current source rate
 
@@ -87,6 +91,292 @@ void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	}
 }
 
+/*
+===============================================================================
+
+COMPACT STORAGE
+
+snd_storage 0 resamples every sound to the output rate when it is loaded,
+as the game always has. From 1 up, sounds are kept at their own rate, which
+for the stock 11 kHz samples is a quarter of the 44.1 kHz copy, and the
+mixer steps through them itself. 2 also packs 16 bit sounds as IMA-ADPCM at
+4 bits a sample. Each sound is stored in whichever of SFX_PCM8, SFX_PCM16 or
+SFX_ADPCM the policy gives for its source, and loadas8bit still turns 16 bit
+sources into 8 bit ones when they aren't packed.
+
+ADPCM data is in blocks of SFX_ADPCM_BLOCK samples that each start from an
+exact sample and step index, so the mixer can start decoding anywhere.
+
+===============================================================================
+*/
+
+static int	adpcm_index[16] =
+{
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static int	adpcm_step[89] =
+{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+/*
+================
+S_ADPCMStep
+
+Applies one code to the predictor and step index; shared by the encoder so
+that it tracks exactly what the decoder will produce
+================
+*/
+static void S_ADPCMStep (int code, int *pred, int *index)
+{
+	int		step, diff;
+
+	step = adpcm_step[*index];
+	diff = step >> 3;
+	if (code & 4)
+		diff += step;
+	if (code & 2)
+		diff += step >> 1;
+	if (code & 1)
+		diff += step >> 2;
+
+	if (code & 8)
+		*pred -= diff;
+	else
+		*pred += diff;
+	if (*pred > 32767)
+		*pred = 32767;
+	else if (*pred < -32768)
+		*pred = -32768;
+
+	*index += adpcm_index[code];
+	if (*index < 0)
+		*index = 0;
+	else if (*index > 88)
+		*index = 88;
+}
+
+/*
+================
+S_EncodeADPCM
+
+in holds count 16 bit samples; the last block is padded with its final sample
+================
+*/
+static void S_EncodeADPCM (short *in, int count, byte *out)
+{
+	int		i, j, sample, pred, index, step, delta, code;
+	byte	*codes;
+
+	index = 0;
+	for (i=0 ; i<count ; i+=SFX_ADPCM_BLOCK, out+=SFX_ADPCM_BLOCKBYTES)
+	{
+		pred = in[i];
+		out[0] = pred & 255;
+		out[1] = (pred >> 8) & 255;
+		out[2] = index;
+		out[3] = 0;
+
+		codes = out + 4;
+		memset (codes, 0, SFX_ADPCM_BLOCKBYTES - 4);
+
+		for (j=1 ; j<SFX_ADPCM_BLOCK ; j++)
+		{
+			sample = i + j < count ? in[i + j] : in[count - 1];
+
+			step = adpcm_step[index];
+			delta = sample - pred;
+			code = 0;
+			if (delta < 0)
+			{
+				code = 8;
+				delta = -delta;
+			}
+			if (delta >= step)
+			{
+				code |= 4;
+				delta -= step;
+			}
+			if (delta >= step >> 1)
+			{
+				code |= 2;
+				delta -= step >> 1;
+			}
+			if (delta >= step >> 2)
+				code |= 1;
+
+			S_ADPCMStep (code, &pred, &index);
+			codes[(j-1) >> 1] |= code << (((j-1) & 1) * 4);
+		}
+	}
+}
+
+/*
+================
+S_DecodeADPCMBlock
+================
+*/
+static void S_DecodeADPCMBlock (byte *in, short *out)
+{
+	int		j, pred, index, code;
+
+	pred = (short)(in[0] | (in[1] << 8));
+	index = in[2];
+	out[0] = pred;
+
+	for (j=1 ; j<SFX_ADPCM_BLOCK ; j++)
+	{
+		code = (in[4 + ((j-1) >> 1)] >> (((j-1) & 1) * 4)) & 15;
+		S_ADPCMStep (code, &pred, &index);
+		out[j] = pred;
+	}
+}
+
+/*
+================
+S_FetchSamples
+
+Expands count stored samples from first on into 16 bit ones for the mixer;
+past the end the last sample is repeated, and an empty sound is silence
+================
+*/
+void S_FetchSamples (sfxcache_t *sc, int first, int count, short *out)
+{
+	int		i, n, c, b, ofs;
+	short	*dest;
+	short	block[SFX_ADPCM_BLOCK];
+
+	if (sc->samples <= 0)
+	{
+		memset (out, 0, count * sizeof(short));
+		return;
+	}
+
+	n = sc->samples - first;
+	if (n > count)
+		n = count;
+
+	if (n <= 0)
+	{
+		S_FetchSamples (sc, sc->samples - 1, 1, out);
+		n = 1;
+	}
+	else if (sc->format == SFX_PCM8)
+	{
+		for (i=0 ; i<n ; i++)
+			out[i] = ((signed char *)sc->data)[first + i] << 8;
+	}
+	else if (sc->format == SFX_PCM16)
+	{
+		memcpy (out, (short *)sc->data + first, n * sizeof(short));
+	}
+	else
+	{
+		b = first / SFX_ADPCM_BLOCK;
+		ofs = first - b * SFX_ADPCM_BLOCK;
+		dest = out;
+		for (i=n ; i>0 ; i-=c, b++, ofs=0)
+		{
+			S_DecodeADPCMBlock (sc->data + b * SFX_ADPCM_BLOCKBYTES, block);
+			c = SFX_ADPCM_BLOCK - ofs;
+			if (c > i)
+				c = i;
+			memcpy (dest, block + ofs, c * sizeof(short));
+			dest += c;
+		}
+	}
+
+	for (i=n ; i<count ; i++)
+		out[i] = out[n-1];
+}
+
+/*
+================
+S_StoreSfx
+
+Caches a sound at its own rate in the format the storage policy gives it
+================
+*/
+static sfxcache_t *S_StoreSfx (sfx_t *s, wavinfo_t *info, byte *data)
+{
+	int		i, format, bytes;
+	float	stepscale;
+	short	*in;
+	sfxcache_t	*sc;
+
+	if (info->width == 1)
+		format = SFX_PCM8;
+	else if (snd_storage.value >= 2)
+		format = SFX_ADPCM;
+	else if (loadas8bit.value)
+		format = SFX_PCM8;
+	else
+		format = SFX_PCM16;
+
+	if (format == SFX_ADPCM)
+		bytes = (info->samples + SFX_ADPCM_BLOCK - 1) / SFX_ADPCM_BLOCK
+				* SFX_ADPCM_BLOCKBYTES;
+	else if (format == SFX_PCM16)
+		bytes = info->samples * 2;
+	else
+		bytes = info->samples;
+
+	sc = Cache_Alloc (&s->cache, bytes + sizeof(sfxcache_t), s->name);
+	if (!sc)
+		return NULL;
+
+	stepscale = (float)info->rate / shm->speed;
+
+	sc->length = info->samples / stepscale;
+	sc->loopstart = info->loopstart;
+	if (sc->loopstart != -1)
+		sc->loopstart = sc->loopstart / stepscale;
+	sc->speed = info->rate;
+	sc->width = format == SFX_PCM16 ? 2 : 1;
+	sc->stereo = 0;
+	sc->format = format;
+	sc->step = ((long long)info->rate << 16) / shm->speed;
+	sc->samples = info->samples;
+	sc->bytes = bytes;
+
+	if (info->width == 1)
+	{
+		for (i=0 ; i<info->samples ; i++)
+			((signed char *)sc->data)[i] = (int)data[i] - 128;
+		return sc;
+	}
+
+	in = (short *)data;
+	if (format == SFX_ADPCM)
+	{
+		for (i=0 ; i<info->samples ; i++)
+			in[i] = LittleShort (in[i]);
+		S_EncodeADPCM (in, info->samples, sc->data);
+	}
+	else if (format == SFX_PCM16)
+	{
+		for (i=0 ; i<info->samples ; i++)
+			((short *)sc->data)[i] = LittleShort (in[i]);
+	}
+	else
+	{
+		for (i=0 ; i<info->samples ; i++)
+			((signed char *)sc->data)[i] = LittleShort (in[i]) >> 8;
+	}
+
+	return sc;
+}
+
 //=============================================================================
 
 /*
@@ -131,6 +421,9 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 		return NULL;
 	}
 
+	if (snd_storage.value >= 1)
+		return S_StoreSfx (s, &info, data + info.dataofs);
+
 	stepscale = (float)info.rate / shm->speed;	
 	len = info.samples / stepscale;
 
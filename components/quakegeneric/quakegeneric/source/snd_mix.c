@@ -20,37 +20,33 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // snd_mix.c -- portable code to mix sounds for snd_dma.c
 
 #include "quakedef.h"
-#include "esp_attr.h"
 
 
 #define	PAINTBUFFER_SIZE	512
-EXT_RAM_BSS_ATTR portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
-EXT_RAM_BSS_ATTR int		snd_scaletable[32][256];
-int 	*snd_p, snd_linear_count, snd_vol;
-short	*snd_out;
+portable_samplepair_t	*paintbuffer;	// PAINTBUFFER_SIZE, placed by SND_InitScaletable
 
-void Snd_WriteLinearBlastStereo16 (void)
+// The paint and transfer loops below are written as straight runs over flat
+// arrays, with multiplies instead of table lookups and clamps that compile to
+// min/max, so the compiler can vectorise them on the host and keep them in
+// registers on the device.
+
+/*
+================
+Snd_WriteLinearBlastStereo16
+
+Scales and saturates count interleaved samples from p into out
+================
+*/
+void Snd_WriteLinearBlastStereo16 (int *p, short *out, int count, int vol)
 {
-	int		i;
-	int		val;
+	int		i, val;
 
-	for (i=0 ; i<snd_linear_count ; i+=2)
+	for (i=0 ; i<count ; i++)
 	{
-		val = (snd_p[i]*snd_vol)>>8;
-		if (val > 0x7fff)
-			snd_out[i] = 0x7fff;
-		else if (val < (short)0x8000)
-			snd_out[i] = (short)0x8000;
-		else
-			snd_out[i] = val;
-
-		val = (snd_p[i+1]*snd_vol)>>8;
-		if (val > 0x7fff)
-			snd_out[i+1] = 0x7fff;
-		else if (val < (short)0x8000)
-			snd_out[i+1] = (short)0x8000;
-		else
-			snd_out[i+1] = val;
+		val = (p[i] * vol) >> 8;
+		val = val > 0x7fff ? 0x7fff : val;
+		val = val < -0x8000 ? -0x8000 : val;
+		out[i] = val;
 	}
 }
 
@@ -59,33 +55,31 @@ void S_TransferStereo16 (int endtime)
 {
 	int		lpos;
 	int		lpaintedtime;
-	unsigned long	*pbuf;
+	int		count, vol;
+	int		*p;
+	short	*out;
 	
-	snd_vol = volume.value*256;
+	vol = volume.value*256;
 
-	snd_p = (int *) paintbuffer;
+	p = (int *) paintbuffer;
 	lpaintedtime = paintedtime;
 
-	pbuf = (unsigned long *)shm->buffer;
+	out = (short *)shm->buffer;
 
 	while (lpaintedtime < endtime)
 	{
 	// handle recirculating buffer issues
 		lpos = lpaintedtime & ((shm->samples>>1)-1);
 
-		snd_out = (short *) pbuf + (lpos<<1);
-
-		snd_linear_count = (shm->samples>>1) - lpos;
-		if (lpaintedtime + snd_linear_count > endtime)
-			snd_linear_count = endtime - lpaintedtime;
-
-		snd_linear_count <<= 1;
+		count = (shm->samples>>1) - lpos;
+		if (lpaintedtime + count > endtime)
+			count = endtime - lpaintedtime;
 
 	// write a linear blast of samples
-		Snd_WriteLinearBlastStereo16 ();
+		Snd_WriteLinearBlastStereo16 (p, out + (lpos<<1), count<<1, vol);
 
-		snd_p += snd_linear_count;
-		lpaintedtime += (snd_linear_count>>1);
+		p += count<<1;
+		lpaintedtime += count;
 	}
 
 }
@@ -158,16 +152,76 @@ CHANNEL MIXING
 ===============================================================================
 */
 
-void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime);
-void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime);
+void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int *pb);
+void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, int *pb);
+void SND_PaintChannelStepped (channel_t *ch, sfxcache_t *sc, int count, int *pb);
 
-void S_PaintChannels(int endtime)
+/*
+================
+SND_PaintChannel
+
+Paints ch from paintedtime up to end, looping it when it runs out; returns
+false once a sound that doesn't loop has finished
+================
+*/
+static qboolean SND_PaintChannel (channel_t *ch, sfxcache_t *sc, int end)
+{
+	int		ltime, count;
+	int		*pb;
+
+	ltime = paintedtime;
+
+	while (ltime < end)
+	{	// paint up to end
+		if (ch->end < end)
+			count = ch->end - ltime;
+		else
+			count = end - ltime;
+
+		if (count > 0)
+		{	
+			pb = (int *)(paintbuffer + (ltime - paintedtime));
+			if (sc->step != 1<<16 || sc->format == SFX_ADPCM)
+				SND_PaintChannelStepped(ch, sc, count, pb);
+			else if (sc->width == 1)
+				SND_PaintChannelFrom8(ch, sc, count, pb);
+			else
+				SND_PaintChannelFrom16(ch, sc, count, pb);
+
+			ltime += count;
+		}
+
+	// if at end of loop, restart
+		if (ltime >= ch->end)
+		{
+			if (sc->loopstart >= 0)
+			{
+				ch->pos = sc->loopstart;
+				ch->end = ltime + sc->length - ch->pos;
+			}
+			else				
+			{	// channel just stopped
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+================
+S_PaintChannelList
+
+cache, when given, holds the already looked up data for each channel;
+otherwise the sounds are loaded as they are painted
+================
+*/
+static void S_PaintChannelList (channel_t *ch, sfxcache_t **cache, int total, int endtime)
 {
 	int 	i;
 	int 	end;
-	channel_t *ch;
 	sfxcache_t	*sc;
-	int		ltime, count;
 
 	while (paintedtime < endtime)
 	{
@@ -180,52 +234,18 @@ void S_PaintChannels(int endtime)
 		Q_memset(paintbuffer, 0, (end - paintedtime) * sizeof(portable_samplepair_t));
 
 	// paint in the channels.
-		ch = channels;
-		for (i=0; i<total_channels ; i++, ch++)
+		for (i=0; i<total ; i++)
 		{
-			if (!ch->sfx)
+			if (!ch[i].sfx)
 				continue;
-			if (!ch->leftvol && !ch->rightvol)
+			if (!ch[i].leftvol && !ch[i].rightvol)
 				continue;
-			sc = S_LoadSound (ch->sfx);
+			sc = cache ? cache[i] : S_LoadSound (ch[i].sfx);
 			if (!sc)
 				continue;
 
-			ltime = paintedtime;
-
-			while (ltime < end)
-			{	// paint up to end
-				if (ch->end < end)
-					count = ch->end - ltime;
-				else
-					count = end - ltime;
-
-				if (count > 0)
-				{	
-					if (sc->width == 1)
-						SND_PaintChannelFrom8(ch, sc, count);
-					else
-						SND_PaintChannelFrom16(ch, sc, count);
-	
-					ltime += count;
-				}
-
-			// if at end of loop, restart
-				if (ltime >= ch->end)
-				{
-					if (sc->loopstart >= 0)
-					{
-						ch->pos = sc->loopstart;
-						ch->end = ltime + sc->length - ch->pos;
-					}
-					else				
-					{	// channel just stopped
-						ch->sfx = NULL;
-						break;
-					}
-				}
-			}
-															  
+			if (!SND_PaintChannel (&ch[i], sc, end))
+				ch[i].sfx = NULL;
 		}
 
 	// transfer out according to DMA format
@@ -234,50 +254,60 @@ void S_PaintChannels(int endtime)
 	}
 }
 
+void S_PaintChannels(int endtime)
+{
+	S_PaintChannelList (channels, NULL, total_channels, endtime);
+}
+
+/*
+================
+SND_InitScaletable
+
+8 bit samples used to be scaled through a 32K table; the same products
+come from a multiply now, so only the paint buffer is left to place
+================
+*/
 void SND_InitScaletable (void)
 {
-	int		i, j;
-	
-	for (i=0 ; i<32 ; i++)
-		for (j=0 ; j<256 ; j++)
-			snd_scaletable[i][j] = ((signed char)j) * i * 8;
+	if (!paintbuffer)
+		paintbuffer = Hunk_PlacedAlloc (PAINTBUFFER_SIZE * sizeof(portable_samplepair_t), "paintbuf");
 }
 
 
-void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count)
+void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int *pb)
 {
-	int 	data;
-	int		*lscale, *rscale;
-	unsigned char *sfx;
-	int		i;
+	int			data;
+	int			lscale, rscale;
+	signed char	*sfx;
+	int			i;
 
 	if (ch->leftvol > 255)
 		ch->leftvol = 255;
 	if (ch->rightvol > 255)
 		ch->rightvol = 255;
-		
-	lscale = snd_scaletable[ch->leftvol >> 3];
-	rscale = snd_scaletable[ch->rightvol >> 3];
+
+// volume keeps 5 bits, as the old table did
+	lscale = (ch->leftvol >> 3) * 8;
+	rscale = (ch->rightvol >> 3) * 8;
 	sfx = (signed char *)sc->data + ch->pos;
 
 	for (i=0 ; i<count ; i++)
 	{
 		data = sfx[i];
-		paintbuffer[i].left += lscale[data];
-		paintbuffer[i].right += rscale[data];
+		pb[i*2] += data * lscale;
+		pb[i*2+1] += data * rscale;
 	}
 	
 	ch->pos += count;
 }
 
 
-void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count)
+void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, int *pb)
 {
-	int data;
-	int left, right;
-	int leftvol, rightvol;
+	int 	data;
+	int 	leftvol, rightvol;
 	signed short *sfx;
-	int	i;
+	int		i;
 
 	leftvol = ch->leftvol;
 	rightvol = ch->rightvol;
@@ -286,12 +316,416 @@ void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count)
 	for (i=0 ; i<count ; i++)
 	{
 		data = sfx[i];
-		left = (data * leftvol) >> 8;
-		right = (data * rightvol) >> 8;
-		paintbuffer[i].left += left;
-		paintbuffer[i].right += right;
+		pb[i*2] += (data * leftvol) >> 8;
+		pb[i*2+1] += (data * rightvol) >> 8;
+	}
+
+	ch->pos += count;
+}
+
+
+/*
+================
+SND_PaintChannelStepped
+
+For sounds cached at their own rate or packed (see snd_mem.c): ch->pos stays
+in output samples, and the stored samples under it are expanded a window at
+a time and interpolated between
+================
+*/
+#define	STEP_WINDOW		128
+
+void SND_PaintChannelStepped (channel_t *ch, sfxcache_t *sc, int count, int *pb)
+{
+	int			i, n, first, frac, step, left;
+	int			s0, data;
+	int			leftvol, rightvol;
+	long long	pos;
+	short		window[STEP_WINDOW + 1];
+
+	leftvol = ch->leftvol;
+	rightvol = ch->rightvol;
+	step = sc->step;
+	pos = (long long)ch->pos * step;
+
+	for (left=count ; left>0 ; left-=n)
+	{
+		first = pos >> 16;
+		S_FetchSamples (sc, first, STEP_WINDOW + 1, window);
+
+	// as many output samples as land inside the window
+		n = ((((long long)(first + STEP_WINDOW) << 16) - pos - 1) / step) + 1;
+		if (n > left)
+			n = left;
+
+		frac = pos - ((long long)first << 16);
+		for (i=0 ; i<n ; i++, frac+=step)
+		{
+			s0 = window[frac >> 16];
+			data = s0 + (((window[(frac >> 16) + 1] - s0) * ((frac >> 8) & 255)) >> 8);
+			pb[i*2] += (data * leftvol) >> 8;
+			pb[i*2+1] += (data * rightvol) >> 8;
+		}
+
+		pb += n*2;
+		pos += (long long)n * step;
 	}
 
 	ch->pos += count;
 }
 
+
+/*
+================
+SND_MixBench_f
+
+Paints MAX_CHANNELS looping sounds, half 8 bit and half 16 bit, into a
+paint buffer of its own and transfers them, without touching the real
+channels or the mixer's buffers
+================
+*/
+#define MIXBENCH_SAMPLES	(PAINTBUFFER_SIZE * 4)
+#define MIXBENCH_PASSES		64
+
+void SND_MixBench_f (void)
+{
+	int				i, j, pass, mark;
+	channel_t		*ch;
+	sfxcache_t		*sc8, *sc16;
+	int				*pb;
+	short			*out;
+	double			start, paint, transfer;
+
+	if (!paintbuffer)
+	{
+		Con_Printf ("sound is not initialized\n");
+		return;
+	}
+
+	mark = Hunk_LowMark ();
+
+	ch = Hunk_AllocName (MAX_CHANNELS * sizeof(channel_t), "mixbench");
+	sc8 = Hunk_AllocName (sizeof(sfxcache_t) + MIXBENCH_SAMPLES, "mixbench");
+	sc16 = Hunk_AllocName (sizeof(sfxcache_t) + MIXBENCH_SAMPLES * 2,
+			"mixbench");
+	pb = Hunk_AllocName (PAINTBUFFER_SIZE * sizeof(portable_samplepair_t), "mixbench");
+	out = Hunk_AllocName (PAINTBUFFER_SIZE * 2 * sizeof(short), "mixbench");
+
+	for (i=0 ; i<MIXBENCH_SAMPLES ; i++)
+	{
+		sc8->data[i] = rand ();
+		((short *)sc16->data)[i] = rand ();
+	}
+
+	for (i=0 ; i<MAX_CHANNELS ; i++)
+	{
+		ch[i].leftvol = (i * 37) & 255;
+		ch[i].rightvol = 255 - ch[i].leftvol;
+	}
+
+	paint = transfer = 0;
+
+	for (pass=0 ; pass<MIXBENCH_PASSES ; pass++)
+	{
+		start = Sys_FloatTime ();
+
+		Q_memset (pb, 0, PAINTBUFFER_SIZE * sizeof(portable_samplepair_t));
+		for (i=0 ; i<MAX_CHANNELS ; i++)
+		{
+			ch[i].pos = (pass * PAINTBUFFER_SIZE + i * 7) %
+					(MIXBENCH_SAMPLES - PAINTBUFFER_SIZE);
+			if (i & 1)
+				SND_PaintChannelFrom16 (&ch[i], sc16, PAINTBUFFER_SIZE, pb);
+			else
+				SND_PaintChannelFrom8 (&ch[i], sc8, PAINTBUFFER_SIZE, pb);
+		}
+
+		paint += Sys_FloatTime () - start;
+		start = Sys_FloatTime ();
+
+		for (j=0 ; j<8 ; j++)
+			Snd_WriteLinearBlastStereo16 (pb, out, PAINTBUFFER_SIZE * 2, 256);
+
+		transfer += (Sys_FloatTime () - start) / 8;
+	}
+
+	Hunk_FreeToLowMark (mark);
+
+	paint /= MIXBENCH_PASSES;
+	transfer /= MIXBENCH_PASSES;
+
+	Con_Printf ("%i channels x %i samples: paint %.1f us (%.3f us/channel),"
+			" transfer %.1f us\n", MAX_CHANNELS, PAINTBUFFER_SIZE,
+			paint * 1000000, paint * 1000000 / MAX_CHANNELS,
+			transfer * 1000000);
+}
+
+
+
+#ifdef SND_MIXTHREAD
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/*
+===============================================================================
+
+MIXING IN THE AUDIO TASK
+
+The game thread doesn't paint. Once a frame it publishes what every channel
+is playing, where it started and how loud it is after spatialization, and
+the audio task picks up the newest state before each chunk it paints.
+
+The state is triple buffered: each side owns one frame outright and they
+trade the third through a single atomic exchange, so neither ever waits on
+the other. paintedtime belongs to the audio task; the game thread only reads
+it to date the channels it starts.
+
+The sound data itself lives in the cache, which the game thread may flush or
+shuffle at any time. The zone code calls S_CacheRelocated before a block is
+freed or moved; it rewrites the task's pointers inside snd_mixmux, which the
+task also takes to pick up a frame, and then waits out the chunk being
+painted if that could still be reading the old block. The critical sections
+only ever cover pointer swaps, never a paint.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	sfx_t		*sfx;			// NULL when the channel is stopped
+	sfxcache_t	*sc;			// NULL while its data isn't in the cache
+	int			start;			// changes each time a sound is started on it
+	int			pos;			// sample to start from
+	int			leftvol, rightvol;
+} sndpublish_t;
+
+typedef struct
+{
+	int				total;
+	sndpublish_t	ch[MAX_CHANNELS];
+} sndframe_t;
+
+#define	SND_FRAME_FRESH		4	// set in snd_midframe until the task takes it
+
+static sndframe_t	*snd_frames;		// [3], hunk allocated
+static int			snd_backframe;		// being written by the game thread
+static int			snd_frontframe;		// last one taken by the audio task
+static int			snd_midframe;		// the one being traded
+static qboolean		snd_mixready;
+
+// the audio task's own channels, advanced as they are painted
+static channel_t	*snd_mixchan;		// [MAX_CHANNELS], hunk allocated
+static sfxcache_t	*snd_mixcache[MAX_CHANNELS];
+static int			snd_mixstart[MAX_CHANNELS];
+static int			snd_mixtotal;
+
+static portMUX_TYPE	snd_mixmux = portMUX_INITIALIZER_UNLOCKED;
+static qboolean		snd_painting;		// a chunk is being painted
+static int			snd_paintcount;		// chunks painted so far
+
+
+/*
+================
+S_InitMixThread
+================
+*/
+void S_InitMixThread (void)
+{
+	if (snd_frames)
+		return;
+
+	snd_frames = Hunk_AllocName (3 * sizeof(sndframe_t), "sndframe");
+	snd_mixchan = Hunk_AllocName (MAX_CHANNELS * sizeof(channel_t), "sndmix");
+
+	snd_backframe = 0;
+	snd_frontframe = 1;
+	snd_midframe = 2;
+
+	__atomic_store_n (&snd_mixready, true, __ATOMIC_RELEASE);
+}
+
+
+/*
+================
+S_PublishChannels
+
+Called by the game thread once the channels have been spatialized
+================
+*/
+void S_PublishChannels (void)
+{
+	int				i;
+	channel_t		*ch;
+	sndframe_t		*f;
+	sndpublish_t	*p;
+
+	if (!snd_frames)
+		return;
+
+	f = &snd_frames[snd_backframe];
+	f->total = total_channels;
+
+	ch = channels;
+	p = f->ch;
+	for (i=0 ; i<total_channels ; i++, ch++, p++)
+	{
+		p->sfx = ch->sfx;
+		p->sc = ch->sfx ? S_LoadSound (ch->sfx) : NULL;
+		p->start = snd_chanstart[i];
+		p->pos = ch->pos;
+		p->leftvol = ch->leftvol;
+		p->rightvol = ch->rightvol;
+	}
+
+	snd_backframe = __atomic_exchange_n (&snd_midframe,
+			snd_backframe | SND_FRAME_FRESH, __ATOMIC_ACQ_REL) & 3;
+}
+
+
+/*
+================
+S_CacheRelocated
+
+Called by the zone code on the game thread just before the cache block
+holding data is freed (newdata NULL) or after it has been copied to
+newdata. Points every published and playing channel at the new copy, or
+pauses the ones whose data is gone until it is loaded again, and returns
+once the audio task can no longer be reading the old block.
+================
+*/
+void S_CacheRelocated (void *data, void *newdata)
+{
+	int			i, j, count;
+	qboolean	inuse;
+	sndframe_t	*f;
+
+	if (!snd_frames)
+		return;
+
+	inuse = false;
+
+	taskENTER_CRITICAL (&snd_mixmux);
+
+	for (i=0 ; i<MAX_CHANNELS ; i++)
+		if (snd_mixcache[i] == data)
+		{
+			snd_mixcache[i] = newdata;
+			inuse = true;
+		}
+
+	for (j=0, f=snd_frames ; j<3 ; j++, f++)
+		for (i=0 ; i<f->total ; i++)
+			if (f->ch[i].sc == data)
+				f->ch[i].sc = newdata;
+
+	inuse &= snd_painting;
+	count = snd_paintcount;
+
+	taskEXIT_CRITICAL (&snd_mixmux);
+
+// the chunk being painted may have fetched the old pointer already; any
+// later one sees the new one
+	while (inuse && __atomic_load_n (&snd_painting, __ATOMIC_ACQUIRE)
+		&& __atomic_load_n (&snd_paintcount, __ATOMIC_ACQUIRE) == count)
+		taskYIELD ();
+}
+
+
+/*
+================
+S_PickupChannels
+
+Brings the audio task's channels up to the newest published frame. A
+channel is restarted only when a new sound was started on it; a one-shot
+the task has already finished stays silent while the game thread still
+lists it, and one whose data was flushed picks up where it paused once the
+data is back. Called inside snd_mixmux.
+================
+*/
+static void S_PickupChannels (void)
+{
+	int				i;
+	channel_t		*m;
+	sndframe_t		*f;
+	sndpublish_t	*p;
+
+	if (!(__atomic_load_n (&snd_midframe, __ATOMIC_ACQUIRE) & SND_FRAME_FRESH))
+		return;
+
+	snd_frontframe = __atomic_exchange_n (&snd_midframe, snd_frontframe,
+			__ATOMIC_ACQ_REL) & 3;
+	f = &snd_frames[snd_frontframe];
+
+	m = snd_mixchan;
+	p = f->ch;
+	for (i=0 ; i<f->total ; i++, m++, p++)
+	{
+		if (!p->sfx)
+		{
+			m->sfx = NULL;
+			snd_mixcache[i] = NULL;
+			continue;
+		}
+
+		if (!p->sc)
+			snd_mixcache[i] = NULL;		// paused until it is reloaded
+		else if (p->start != snd_mixstart[i])
+		{
+			m->sfx = p->sfx;
+			m->pos = p->pos;
+			m->end = paintedtime + p->sc->length - p->pos;
+			snd_mixcache[i] = p->sc;
+			snd_mixstart[i] = p->start;
+		}
+		else if (!snd_mixcache[i])
+		{	// reloaded after a flush; carry on from where it paused
+			snd_mixcache[i] = p->sc;
+			if (m->sfx)
+				m->end = paintedtime + p->sc->length - m->pos;
+		}
+
+		m->leftvol = p->leftvol;
+		m->rightvol = p->rightvol;
+	}
+
+	for ( ; i<snd_mixtotal ; i++, m++)
+	{
+		m->sfx = NULL;
+		snd_mixcache[i] = NULL;
+	}
+
+	snd_mixtotal = f->total;
+}
+
+
+/*
+================
+S_PaintAhead
+
+Called by the audio task for each chunk it sends: paints the next count
+sample pairs and returns them in the DMA buffer, or NULL if sound isn't up
+yet. count must divide the buffer so that a chunk never wraps.
+================
+*/
+short *S_PaintAhead (int count)
+{
+	int		start;
+
+	if (!__atomic_load_n (&snd_mixready, __ATOMIC_ACQUIRE) || !shm)
+		return NULL;
+
+	taskENTER_CRITICAL (&snd_mixmux);
+	S_PickupChannels ();
+	snd_painting = true;
+	taskEXIT_CRITICAL (&snd_mixmux);
+
+	start = paintedtime;
+	S_PaintChannelList (snd_mixchan, snd_mixcache, snd_mixtotal, start + count);
+
+	__atomic_store_n (&snd_paintcount, snd_paintcount + 1, __ATOMIC_RELEASE);
+	__atomic_store_n (&snd_painting, false, __ATOMIC_RELEASE);
+
+	return (short *)shm->buffer + ((start & ((shm->samples>>1)-1)) << 1);
+}
+
+#endif	// SND_MIXTHREAD
@@ -25,6 +25,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define DEFAULT_SOUND_PACKET_VOLUME 255
 #define DEFAULT_SOUND_PACKET_ATTENUATION 1.0
 
+#ifdef ESP_PLATFORM
+// the audio task paints the channels itself; the game thread only publishes
+// them (see snd_mix.c)
+#define SND_MIXTHREAD
+#endif
+
 // !!! if this is changed, it much be changed in asm_i386.h too !!!
 typedef struct
 {
@@ -38,14 +44,27 @@ typedef struct sfx_s
 	cache_user_t	cache;
 } sfx_t;
 
+// how a cached sound is stored, see snd_mem.c
+#define	SFX_PCM8		0
+#define	SFX_PCM16		1
+#define	SFX_ADPCM		2		// IMA-ADPCM in blocks that can be decoded alone
+#define	SFX_NUMFORMATS	3
+
+#define	SFX_ADPCM_BLOCK			64	// samples per block
+#define	SFX_ADPCM_BLOCKBYTES	36	// first sample, step index, pad, 63 codes
+
 // !!! if this is changed, it much be changed in asm_i386.h too !!!
 typedef struct
 {
-	int 	length;
-	int 	loopstart;
-	int 	speed;
+	int 	length;			// in output samples
+	int 	loopstart;		// in output samples, -1 = no looping
+	int 	speed;			// rate the data is stored at
 	int 	width;
 	int 	stereo;
+	int		format;			// SFX_PCM8, SFX_PCM16 or SFX_ADPCM
+	int		step;			// stored samples per output sample, 16.16
+	int		samples;		// stored samples
+	int		bytes;			// size of data
 	byte	data[1];		// variable sized
 } sfxcache_t;
 
@@ -138,6 +157,9 @@ extern	channel_t   channels[MAX_CHANNELS];
 
 extern	int			total_channels;
 
+// bumped each time a sound is started on a channel
+extern	int			snd_chanstart[MAX_CHANNELS];
+
 //
 // Fake dma is a synchronous faking of the DMA progress used for
 // isolating performance in the renderer.  The fakedma_updates is
@@ -156,6 +178,7 @@ extern volatile dma_t sn;
 extern vec_t sound_nominal_clip_dist;
 
 extern	cvar_t loadas8bit;
+extern	cvar_t snd_storage;
 extern	cvar_t bgmvolume;
 extern	cvar_t volume;
 
@@ -167,10 +190,19 @@ void S_LocalSound (char *s);
 sfxcache_t *S_LoadSound (sfx_t *s);
 
 wavinfo_t GetWavinfo (char *name, byte *wav, int wavlength);
+void S_FetchSamples (sfxcache_t *sc, int first, int count, short *out);
 
 void SND_InitScaletable (void);
+void SND_MixBench_f (void);
 void SNDDMA_Submit(void);
 
+#ifdef SND_MIXTHREAD
+void S_InitMixThread (void);
+void S_PublishChannels (void);
+short *S_PaintAhead (int count);
+void S_CacheRelocated (void *data, void *newdata);
+#endif
+
 void S_AmbientOff (void);
 void S_AmbientOn (void);
 
@@ -36,6 +36,19 @@ int Sys_FileWrite (int handle, void *data, int count);
 int	Sys_FileTime (char *path);
 void Sys_mkdir (char *path);
 
+void Sys_FileReadAhead (int handle, int count);
+// hint that count bytes from the current position are read next
+
+typedef void (*sysfiledone_t) (void *dest, int count, void *parm);
+
+qboolean Sys_FileReadAsync (int handle, int position, void *dest, int count,
+	sysfiledone_t callback, void *parm);
+// queues a read that completes during later Sys_FileService calls; count
+// passed to the callback is what was actually read.  false if the queue is full
+void Sys_FileService (void);
+void Sys_FileFinishAsync (int handle);	// 0 for all handles
+void Sys_FileStats (void);
+
 //
 // memory protection
 //
@@ -34,15 +34,47 @@ FILE IO
 ===============================================================================
 */
 
-#define MAX_HANDLES             10
-FILE    *sys_handles[MAX_HANDLES];
+// Reads go through one shared window buffer instead of stdio.  The window is
+// filled with large reads starting on a sector boundary, so the SD card sees
+// few, big, aligned transfers; reads bigger than the window go straight to the
+// caller's buffer.  Callers can hint how much they are about to read so the
+// window isn't filled past what they need (the next file in a pak, usually).
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#endif
+
+#define MAX_HANDLES             32
+
+#define SYS_SECTOR              512
+#define SYS_READBUF             (32*1024)	// window size, multiple of SYS_SECTOR
+
+typedef struct
+{
+	FILE	*f;
+	int		length;		// -1 for files opened for writing
+	int		pos;		// logical position, the stream is seeked lazily
+	int		readahead;	// bytes the caller said are coming, 0 = unknown
+} sysfile_t;
+
+sysfile_t	sys_handles[MAX_HANDLES];
+
+static byte	*sys_readbuf;		// DMA capable on the handheld
+static int	sys_bufhandle;		// 0 = window empty
+static int	sys_bufstart, sys_buflen;
+
+// counters, cleared by Sys_FileStats
+static int		sys_devreads;		// transfers from the device
+static int		sys_devbytes;
+static int		sys_readbytes;		// bytes handed to callers
+static double	sys_devtime, sys_devmaxtime;
 
 int             findhandle (void)
 {
 	int             i;
 	
 	for (i=1 ; i<MAX_HANDLES ; i++)
-		if (!sys_handles[i])
+		if (!sys_handles[i].f)
 			return i;
 	Sys_Error ("out of handles");
 	return -1;
@@ -66,6 +98,75 @@ int filelength (FILE *f)
 	return end;
 }
 
+/*
+================
+Sys_DeviceRead
+
+One timed transfer from the device
+================
+*/
+static int Sys_DeviceRead (sysfile_t *sf, int position, void *dest, int count)
+{
+	double	time;
+	int		r;
+
+	time = Sys_FloatTime ();
+
+	fseek (sf->f, position, SEEK_SET);
+	r = fread (dest, 1, count, sf->f);
+
+	time = Sys_FloatTime () - time;
+	sys_devtime += time;
+	if (time > sys_devmaxtime)
+		sys_devmaxtime = time;
+	sys_devreads++;
+	if (r > 0)
+		sys_devbytes += r;
+
+	return r;
+}
+
+/*
+================
+Sys_FillWindow
+
+Loads the window with the sector containing position and as much after it as
+is wanted, up to the window size
+================
+*/
+static void Sys_FillWindow (int handle, int position, int wanted)
+{
+	sysfile_t	*sf;
+	int			start, len;
+
+	if (!sys_readbuf)
+	{
+#ifdef ESP_PLATFORM
+		sys_readbuf = heap_caps_aligned_alloc (64, SYS_READBUF, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+#else
+		sys_readbuf = malloc (SYS_READBUF);
+#endif
+		if (!sys_readbuf)
+			Sys_Error ("Sys_FillWindow: couldn't allocate read buffer");
+	}
+
+	sf = &sys_handles[handle];
+
+	start = position & ~(SYS_SECTOR-1);
+	len = position + wanted - start;
+	len = (len + SYS_SECTOR - 1) & ~(SYS_SECTOR-1);
+	if (len > SYS_READBUF)
+		len = SYS_READBUF;
+	if (start + len > sf->length)
+		len = sf->length - start;
+
+	sys_bufhandle = handle;
+	sys_bufstart = start;
+	sys_buflen = Sys_DeviceRead (sf, start, sys_readbuf, len);
+	if (sys_buflen < 0)
+		sys_buflen = 0;
+}
+
 int Sys_FileOpenRead (char *path, int *hndl)
 {
 	FILE    *f;
@@ -79,10 +180,14 @@ int Sys_FileOpenRead (char *path, int *hndl)
 		*hndl = -1;
 		return -1;
 	}
-	sys_handles[i] = f;
+	setvbuf (f, NULL, _IONBF, 0);	// the window does the buffering
+	sys_handles[i].f = f;
+	sys_handles[i].length = filelength(f);
+	sys_handles[i].pos = 0;
+	sys_handles[i].readahead = 0;
 	*hndl = i;
 	
-	return filelength(f);
+	return sys_handles[i].length;
 }
 
 int Sys_FileOpenWrite (char *path)
@@ -95,30 +200,258 @@ int Sys_FileOpenWrite (char *path)
 	f = fopen(path, "wb");
 	if (!f)
 		Sys_Error ("Error opening %s: %s", path,strerror(errno));
-	sys_handles[i] = f;
+	sys_handles[i].f = f;
+	sys_handles[i].length = -1;
+	sys_handles[i].pos = 0;
+	sys_handles[i].readahead = 0;
 	
 	return i;
 }
 
 void Sys_FileClose (int handle)
 {
-	fclose (sys_handles[handle]);
-	sys_handles[handle] = NULL;
+	Sys_FileFinishAsync (handle);
+
+	if (sys_bufhandle == handle)
+		sys_bufhandle = 0;
+	fclose (sys_handles[handle].f);
+	sys_handles[handle].f = NULL;
 }
 
 void Sys_FileSeek (int handle, int position)
 {
-	fseek (sys_handles[handle], position, SEEK_SET);
+	sys_handles[handle].pos = position;
+	sys_handles[handle].readahead = 0;
+
+	if (sys_handles[handle].length < 0)
+		fseek (sys_handles[handle].f, position, SEEK_SET);
+}
+
+/*
+================
+Sys_FileReadAhead
+
+Hint that the next count bytes from the current position are about to be
+read, and probably nothing after them
+================
+*/
+void Sys_FileReadAhead (int handle, int count)
+{
+	sys_handles[handle].readahead = count;
 }
 
 int Sys_FileRead (int handle, void *dest, int count)
 {
-	return fread (dest, 1, count, sys_handles[handle]);
+	sysfile_t	*sf;
+	byte		*out;
+	int			n, wanted;
+
+	sf = &sys_handles[handle];
+	out = dest;
+
+	if (count > sf->length - sf->pos)
+		count = sf->length - sf->pos;
+	if (count <= 0)
+		return 0;
+
+	while (count)
+	{
+		if (sys_bufhandle == handle && sf->pos >= sys_bufstart
+		&& sf->pos < sys_bufstart + sys_buflen)
+		{
+		// from the window
+			n = sys_bufstart + sys_buflen - sf->pos;
+			if (n > count)
+				n = count;
+			memcpy (out, sys_readbuf + sf->pos - sys_bufstart, n);
+		}
+		else if (!(sf->pos & (SYS_SECTOR-1)) && count >= SYS_READBUF)
+		{
+		// big aligned run straight into the destination, the tail goes
+		// through the window
+			n = Sys_DeviceRead (sf, sf->pos, out, count & ~(SYS_SECTOR-1));
+			if (n <= 0)
+				break;
+		}
+		else
+		{
+			wanted = sf->readahead > count ? sf->readahead : count;
+			if (!sf->readahead)
+				wanted = SYS_READBUF;
+			Sys_FillWindow (handle, sf->pos, wanted);
+			if (sf->pos >= sys_bufstart + sys_buflen)
+				break;		// read error
+			continue;
+		}
+
+		out += n;
+		count -= n;
+		sf->pos += n;
+		if (sf->readahead > n)
+			sf->readahead -= n;
+		else
+			sf->readahead = 0;
+	}
+
+	sys_readbytes += out - (byte *)dest;
+
+	return out - (byte *)dest;
 }
 
 int Sys_FileWrite (int handle, void *data, int count)
 {
-	return fwrite (data, 1, count, sys_handles[handle]);
+	return fwrite (data, 1, count, sys_handles[handle].f);
+}
+
+/*
+===============================================================================
+
+ASYNC FILE IO
+
+Reads queued with Sys_FileReadAsync are carried out a chunk at a time from
+Sys_FileService, which the host calls once a frame, and report through their
+callback when complete.  They use their own position, so synchronous reads
+on the same handle are unaffected.
+
+===============================================================================
+*/
+
+#define MAX_ASYNC_READS         8
+#define SYS_ASYNCCHUNK          (64*1024)	// per request per service call
+
+typedef struct
+{
+	int				handle;		// 0 = free slot
+	int				position;
+	byte			*dest;
+	int				count;
+	int				done;
+	sysfiledone_t	callback;
+	void			*parm;
+} sysasync_t;
+
+static sysasync_t	sys_async[MAX_ASYNC_READS];
+
+/*
+================
+Sys_FileReadAsync
+
+Returns false if the queue is full
+================
+*/
+qboolean Sys_FileReadAsync (int handle, int position, void *dest, int count,
+	sysfiledone_t callback, void *parm)
+{
+	int		i;
+
+	for (i=0 ; i<MAX_ASYNC_READS ; i++)
+		if (!sys_async[i].handle)
+			break;
+	if (i == MAX_ASYNC_READS)
+		return false;
+
+	sys_async[i].handle = handle;
+	sys_async[i].position = position;
+	sys_async[i].dest = dest;
+	sys_async[i].count = count;
+	sys_async[i].done = 0;
+	sys_async[i].callback = callback;
+	sys_async[i].parm = parm;
+
+	return true;
+}
+
+/*
+================
+Sys_ServiceAsync
+
+Advances one request by up to a chunk, returns true when it has completed
+================
+*/
+static qboolean Sys_ServiceAsync (sysasync_t *a)
+{
+	sysfile_t	*sf;
+	int			savedpos, savedahead, n;
+
+	sf = &sys_handles[a->handle];
+	savedpos = sf->pos;
+	savedahead = sf->readahead;
+
+	n = a->count - a->done;
+	if (n > SYS_ASYNCCHUNK)
+		n = SYS_ASYNCCHUNK;
+
+	sf->pos = a->position + a->done;
+	sf->readahead = a->count - a->done;
+	n = Sys_FileRead (a->handle, a->dest + a->done, n);
+	sf->pos = savedpos;
+	sf->readahead = savedahead;
+
+	if (n > 0)
+		a->done += n;
+	if (n > 0 && a->done < a->count)
+		return false;
+
+	a->handle = 0;
+	if (a->callback)
+		a->callback (a->dest, a->done, a->parm);
+	return true;
+}
+
+/*
+================
+Sys_FileService
+================
+*/
+void Sys_FileService (void)
+{
+	int		i;
+
+	for (i=0 ; i<MAX_ASYNC_READS ; i++)
+		if (sys_async[i].handle)
+			Sys_ServiceAsync (&sys_async[i]);
+}
+
+/*
+================
+Sys_FileFinishAsync
+
+Completes every queued read on handle, or on all handles if handle is 0
+================
+*/
+void Sys_FileFinishAsync (int handle)
+{
+	int		i;
+
+	for (i=0 ; i<MAX_ASYNC_READS ; i++)
+	{
+		if (!sys_async[i].handle)
+			continue;
+		if (handle && sys_async[i].handle != handle)
+			continue;
+		while (!Sys_ServiceAsync (&sys_async[i]))
+			;
+	}
+}
+
+/*
+================
+Sys_FileStats
+
+Prints and clears the read counters
+================
+*/
+void Sys_FileStats (void)
+{
+	Con_Printf ("%i device reads, %ik read, %ik delivered\n", sys_devreads,
+			sys_devbytes >> 10, sys_readbytes >> 10);
+	if (sys_devreads)
+		Con_Printf ("%.2f ms avg %.2f ms max latency, %ik/s\n",
+				sys_devtime * 1000 / sys_devreads, sys_devmaxtime * 1000,
+				sys_devtime > 0 ? (int)(sys_devbytes / sys_devtime / 1024) : 0);
+
+	sys_devreads = sys_devbytes = sys_readbytes = 0;
+	sys_devtime = sys_devmaxtime = 0;
 }
 
 int     Sys_FileTime (char *path)
@@ -63,6 +63,14 @@ void	VID_SetPalette (unsigned char *palette);
 void	VID_ShiftPalette (unsigned char *palette);
 // called for bonus and pain flashes, and for underwater color changes
 
+#ifdef ESP_PLATFORM
+#define VID_PALETTE565		// the display scans out RGB565
+#endif
+
+void	VID_ShiftPalette565 (unsigned short *palette);
+// called instead of VID_ShiftPalette if VID_PALETTE565 is defined, with the
+// shifted palette already converted
+
 void	VID_Init (unsigned char *palette);
 // Called at startup to set up translation tables, takes 256 8 bit RGB values
 // the palette data will go away after the call, so it must be copied off if
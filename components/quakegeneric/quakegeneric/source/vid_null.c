@@ -46,6 +46,14 @@ void	VID_ShiftPalette (unsigned char *palette)
 	QG_SetPalette(palette);
 }
 
+#ifdef VID_PALETTE565
+void	VID_ShiftPalette565 (unsigned short *palette)
+{
+	// quake generic
+	QG_SetPalette565(palette);
+}
+#endif
+
 void	VID_Init (unsigned char *palette)
 {
 	zbuffer = calloc(BASEWIDTH*BASEHEIGHT, sizeof(short));
@@ -260,6 +260,11 @@ cvar_t		v_gamma = {"gamma", "1", true};
 
 byte		gammatable[256];	// palette is sent through this
 
+#ifdef VID_PALETTE565
+// gammatable with each channel already shifted into its RGB565 field
+static unsigned short	gamma565[3][256];
+#endif
+
 void BuildGammaTable (float g)
 {
 	int		i, inf;
@@ -268,18 +273,28 @@ void BuildGammaTable (float g)
 	{
 		for (i=0 ; i<256 ; i++)
 			gammatable[i] = i;
-		return;
 	}
-	
+	else
+	{
+		for (i=0 ; i<256 ; i++)
+		{
+			inf = 255 * pow ( (i+0.5)/255.5 , g ) + 0.5;
+			if (inf < 0)
+				inf = 0;
+			if (inf > 255)
+				inf = 255;
+			gammatable[i] = inf;
+		}
+	}
+
+#ifdef VID_PALETTE565
 	for (i=0 ; i<256 ; i++)
 	{
-		inf = 255 * pow ( (i+0.5)/255.5 , g ) + 0.5;
-		if (inf < 0)
-			inf = 0;
-		if (inf > 255)
-			inf = 255;
-		gammatable[i] = inf;
+		gamma565[0][i] = (gammatable[i] >> 3) << 11;
+		gamma565[1][i] = (gammatable[i] >> 2) << 5;
+		gamma565[2][i] = gammatable[i] >> 3;
 	}
+#endif
 }
 
 /*
@@ -477,8 +492,13 @@ void V_UpdatePalette (void)
 {
 	int		i, j;
 	qboolean	new;
-	byte	*basepal, *newpal;
+	byte	*basepal;
+#ifdef VID_PALETTE565
+	unsigned short	pal[256], *newpal;
+#else
+	byte	*newpal;
 	byte	pal[768];
+#endif
 	int		r,g,b;
 	qboolean force;
 
@@ -532,13 +552,21 @@ void V_UpdatePalette (void)
 			b += (cl.cshifts[j].percent*(cl.cshifts[j].destcolor[2]-b))>>8;
 		}
 		
+#ifdef VID_PALETTE565
+		*newpal++ = gamma565[0][r] | gamma565[1][g] | gamma565[2][b];
+#else
 		newpal[0] = gammatable[r];
 		newpal[1] = gammatable[g];
 		newpal[2] = gammatable[b];
 		newpal += 3;
+#endif
 	}
 
+#ifdef VID_PALETTE565
+	VID_ShiftPalette565 (pal);
+#else
 	VID_ShiftPalette (pal);	
+#endif
 }
 
 /* 
@@ -44,6 +44,7 @@ typedef struct
 
 void Cache_FreeLow (int new_low_hunk);
 void Cache_FreeHigh (int new_high_hunk);
+void Hunk_FreeFastToLowMark (int mark);
 
 
 /*
@@ -264,6 +265,7 @@ void Z_CheckHeap (void)
 //============================================================================
 
 #define	HUNK_SENTINAL	0x1df001ed
+#define	HUNK_FAST_SENTINAL	0x1df00fa5	// header-only block for a fast allocation
 
 typedef struct
 {
@@ -296,7 +298,7 @@ void Hunk_Check (void)
 	
 	for (h = (hunk_t *)hunk_base ; (byte *)h != hunk_base + hunk_low_used ; )
 	{
-		if (h->sentinal != HUNK_SENTINAL)
+		if (h->sentinal != HUNK_SENTINAL && h->sentinal != HUNK_FAST_SENTINAL)
 			Sys_Error ("Hunk_Check: trahsed sentinal");
 		if (h->size < 16 || h->size + (byte *)h - hunk_base > hunk_size)
 			Sys_Error ("Hunk_Check: bad size");
@@ -354,7 +356,7 @@ void Hunk_Print (qboolean all)
 	//
 	// run consistancy checks
 	//
-		if (h->sentinal != HUNK_SENTINAL)
+		if (h->sentinal != HUNK_SENTINAL && h->sentinal != HUNK_FAST_SENTINAL)
 			Sys_Error ("Hunk_Check: trahsed sentinal");
 		if (h->size < 16 || h->size + (byte *)h - hunk_base > hunk_size)
 			Sys_Error ("Hunk_Check: bad size");
@@ -441,14 +443,180 @@ int	Hunk_LowMark (void)
 	return hunk_low_used;
 }
 
+int	Hunk_FreeSpace (void)
+{
+	return (hunk_size - hunk_low_used - hunk_high_used - (int)sizeof(hunk_t)) & ~15;
+}
+
+void *Hunk_LowPointer (int mark)
+{
+	if (mark < 0 || mark > hunk_low_used)
+		Sys_Error ("Hunk_LowPointer: bad mark %i", mark);
+	return hunk_base + mark;
+}
+
 void Hunk_FreeToLowMark (int mark)
 {
 	if (mark < 0 || mark > hunk_low_used)
 		Sys_Error ("Hunk_FreeToLowMark: bad mark %i", mark);
+	Hunk_FreeFastToLowMark (mark);
 	memset (hunk_base + mark, 0, hunk_low_used - mark);
 	hunk_low_used = mark;
 }
 
+/*
+===============================================================================
+
+MEMORY PLACEMENT
+
+The host can hand over a second, small block of fast memory next to the hunk
+(internal RAM on the handheld, where the hunk itself lives in external RAM).
+Hot buffers named in mem_places that prefer it are served from there while it
+has room; everything else, and anything that doesn't fit, comes from the low
+hunk as usual.
+
+Each fast allocation also leaves a header-only block on the low hunk holding
+the fast offset it started at, so Hunk_FreeToLowMark gives fast memory back
+in step with the hunk.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	char		*name;		// hunk name the buffer is allocated under
+	qboolean	fast;		// preferred region
+	int			size;		// bytes last requested
+	void		*base;		// NULL if not currently allocated
+	qboolean	infast;		// where it actually landed
+} memplace_t;
+
+static memplace_t	mem_places[] =
+{
+	{"colormap", true},		// alias and surface lighting
+	{"scantab", true},		// d_scantable
+	{"zspantab", true},		// zspantable
+	{"edges", true},		// edge pool
+	{"surfaces", true},		// surface pool
+	{"spans", true},		// R_ScanEdges span pool
+	{"paintbuf", true},		// sound mixing accumulator
+	{"globals", true},		// QuakeC globals
+	{NULL}
+};
+
+byte	*fastmem_base;
+int		fastmem_size;
+int		fastmem_used;
+
+/*
+===================
+Hunk_FreeFastToLowMark
+
+Releases the fast allocations made since the low hunk was at mark
+===================
+*/
+void Hunk_FreeFastToLowMark (int mark)
+{
+	hunk_t		*h;
+	memplace_t	*p;
+
+	for (h = (hunk_t *)(hunk_base + mark) ; (byte *)h != hunk_base + hunk_low_used ;
+		h = (hunk_t *)((byte *)h+h->size))
+	{
+		if (h->sentinal == HUNK_FAST_SENTINAL)
+		{
+			fastmem_used = *(int *)(h+1);
+			break;
+		}
+	}
+
+	for (p=mem_places ; p->name ; p++)
+	{
+		if (!p->base)
+			continue;
+		if (p->infast)
+		{
+			if ((byte *)p->base >= fastmem_base + fastmem_used)
+				p->base = NULL;
+		}
+		else if ((byte *)p->base >= hunk_base + mark)
+			p->base = NULL;
+	}
+}
+
+/*
+===================
+Hunk_PlacedAlloc
+
+Allocates a buffer named in mem_places in its preferred region, falling back
+to the low hunk.  Lives exactly as long as a Hunk_AllocName at the same point.
+===================
+*/
+void *Hunk_PlacedAlloc (int size, char *name)
+{
+	memplace_t	*p;
+	hunk_t		*h;
+	byte		*buf;
+	int			fastsize;
+
+	for (p=mem_places ; p->name ; p++)
+		if (!strcmp (p->name, name))
+			break;
+
+	if (!p->name)
+		Sys_Error ("Hunk_PlacedAlloc: %s has no placement", name);
+
+	fastsize = (size+15)&~15;
+
+	if (p->fast && fastsize <= fastmem_size - fastmem_used)
+	{
+		h = (hunk_t *)Hunk_AllocName (sizeof(int), name) - 1;
+		h->sentinal = HUNK_FAST_SENTINAL;
+		*(int *)(h+1) = fastmem_used;
+
+		buf = fastmem_base + fastmem_used;
+		fastmem_used += fastsize;
+		memset (buf, 0, fastsize);
+		p->infast = true;
+	}
+	else
+	{
+		buf = Hunk_AllocName (size, name);
+		p->infast = false;
+	}
+
+	p->base = buf;
+	p->size = size;
+
+	return buf;
+}
+
+/*
+===================
+Memory_Report
+
+Prints where each placed buffer landed
+===================
+*/
+void Memory_Report (void)
+{
+	memplace_t	*p;
+
+	Con_Printf ("%ik of %ik fast memory used\n", (fastmem_used + 1023) >> 10,
+			fastmem_size >> 10);
+
+	for (p=mem_places ; p->name ; p++)
+	{
+		if (!p->base)
+			Con_Printf ("%-8s %-4s %7s -\n", p->name, p->fast ? "fast" : "hunk",
+					"");
+		else
+			Con_Printf ("%-8s %-4s %7i %s\n", p->name, p->fast ? "fast" : "hunk",
+					p->size, p->infast ? "fast" : "hunk");
+	}
+}
+
+
 int	Hunk_HighMark (void)
 {
 	if (hunk_tempactive)
@@ -583,6 +751,9 @@ void Cache_Move ( cache_system_t *c)
 //		Con_Printf ("cache_move ok\n");
 
 		Q_memcpy ( new+1, c+1, c->size - sizeof(cache_system_t) );
+#ifdef SND_MIXTHREAD
+		S_CacheRelocated (c+1, new+1);
+#endif
 		new->user = c->user;
 		Q_memcpy (new->name, c->name, sizeof(new->name));
 		Cache_Free (c->user);
@@ -828,6 +999,10 @@ void Cache_Free (cache_user_t *c)
 	if (!c->data)
 		Sys_Error ("Cache_Free: not allocated");
 
+#ifdef SND_MIXTHREAD
+	S_CacheRelocated (c->data, NULL);	// the audio task may still be playing it
+#endif
+
 	cs = ((cache_system_t *)c->data) - 1;
 
 	cs->prev->next = cs->next;
@@ -931,5 +1106,21 @@ void Memory_Init (void *buf, int size)
 	}
 	mainzone = Hunk_AllocName (zonesize, "zone" );
 	Z_ClearZone (mainzone, zonesize);
+
+	Cmd_AddCommand ("memplace", Memory_Report);
+}
+
+/*
+========================
+Memory_InitFast
+
+Hands the placement layer its fast memory; buf may be NULL
+========================
+*/
+void Memory_InitFast (void *buf, int size)
+{
+	fastmem_base = buf;
+	fastmem_size = buf ? size : 0;
+	fastmem_used = 0;
 }
 
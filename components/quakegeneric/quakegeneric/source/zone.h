@@ -84,6 +84,8 @@ Zone block
 */
 
 void Memory_Init (void *buf, int size);
+void Memory_InitFast (void *buf, int size);
+void Memory_Report (void);
 
 void Z_Free (void *ptr);
 void *Z_Malloc (int size);			// returns 0 filled memory
@@ -98,8 +100,14 @@ void *Hunk_AllocName (int size, char *name);
 
 void *Hunk_HighAllocName (int size, char *name);
 
+void *Hunk_PlacedAlloc (int size, char *name);
+// like Hunk_AllocName, but served from fast memory if the placement table
+// prefers it there and it fits
+
 int	Hunk_LowMark (void);
 void Hunk_FreeToLowMark (int mark);
+void *Hunk_LowPointer (int mark);	// address of a low mark, for raw copies
+int	Hunk_FreeSpace (void);			// largest Hunk_AllocName that won't fail
 
 int	Hunk_HighMark (void);
 void Hunk_FreeToHighMark (int mark);
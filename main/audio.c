@@ -38,14 +38,13 @@ int snd_inited;
 
 unsigned char dma_buffer[BUFFER_SIZE];
 
-int dma_rpos;
-
 void CDAudio_get_samps(char *samps, int len_bytes);
 
 #define CHUNKSZ (BUFFER_SIZE/8)
 void audio_task(void *param) {
 	printf("audio task running\n");
-	//simulate DMA to audio; just write the DMA buffer in a circular fashion.
+	//The game thread only publishes channel state; the mixing itself happens
+	//here, one chunk ahead of I2S, so slow frames can't starve the output.
 	int16_t *mix_buf=calloc(CHUNKSZ/2, sizeof(int16_t));
 	int old_volume=-1;
         while(1) {
@@ -58,16 +57,16 @@ void audio_task(void *param) {
 		int cdvol = (int)(bgmvolume.value * 255.0);
 
 		CDAudio_get_samps((char*)mix_buf, CHUNKSZ);
-		int16_t *digaudio=(int16_t*)&dma_buffer[dma_rpos];
+		//paint the game sounds for this chunk (16-bit stereo, so 4 bytes a pair)
+		int16_t *digaudio=S_PaintAhead(CHUNKSZ/4);
 		//Mix CD audio and digi samples
 		for (int i=0; i<CHUNKSZ/2; i++) {
 			int a=(((int)mix_buf[i])*cdvol)/256;
 //			int a=mix_buf[i];
-			int b=digaudio[i];
+			int b=digaudio ? digaudio[i] : 0;
 			int mixed=(a*24)+(b*8); //set mix ratio between cd music and game audio here
 			mix_buf[i]=mixed/32;
 		}
-		dma_rpos=(dma_rpos + CHUNKSZ) % BUFFER_SIZE;
 /*
 		esp_codec_dev_write(spk_codec_dev, mix_buf, CHUNKSZ);
 */
@@ -112,7 +111,8 @@ qboolean SNDDMA_Init(void)
 int SNDDMA_GetDMAPos(void) //in (e.g. 16-bit) samples
 {
 	if (!snd_inited) return (0);
-	shm->samplepos=dma_rpos / (shm->samplebits / 8);
+	//the audio task paints right before it sends, so the painted position is the play position
+	shm->samplepos=(paintedtime*shm->channels) & (shm->samples-1);
 	return shm->samplepos;
 }
 
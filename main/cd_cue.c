@@ -14,8 +14,9 @@
 
 #include "quakedef.h"
 #include "esp_attr.h"
-#include "freertos/ringbuf.h"
-#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <fnmatch.h>
 #include <sys/types.h>
 #include <dirent.h>
@@ -24,6 +25,14 @@
 Note: The GOG release of the game includes the CDs as cue/gog (actually cue/bin) files
 which contains the raw audio as 16-bit signed LE 44100KHz audio. We can simply open those
 and use the track timecode to seek to the correct place, then play the track raw.
+
+Streaming: cd_task reads the track into a ring of CD_SLOTS slots in PSRAM, one large read
+per slot, aligned to CD_READ_SZ in the bin file once past the start of the track. The
+audio task drains the ring in CDAudio_get_samps and never waits on it; if the card has
+stalled and the ring runs dry, the rest of the chunk is silence. Each slot is tagged with
+the play request it was read for, so a new CDAudio_Play drops whatever is still queued
+from the old track right away. The two sides only share the slot counters, which each
+side advances on its own.
 */
 
 #define CD_FRAME_SIZE 2352
@@ -42,8 +51,6 @@ typedef struct {
 track_t tracks[MAX_TRK]={0};
 FILE *cdfile;
 
-SemaphoreHandle_t player_ctl_mux;
-
 //Borrowed from the Binchunker source code
 static long time2frames(char *s)
 {
@@ -101,8 +108,21 @@ static FILE* open_cuefile(const char *basedir) {
 }
 
 void cd_task(void *param);
-RingbufHandle_t ringbuf;
-#define RINGBUF_SZ (CD_FRAME_SIZE*32)
+
+#define CD_READ_SZ (32*1024)	//bytes per read, and per slot
+#define CD_SLOTS 8				//256K, about 1.5 seconds of audio
+
+typedef struct {
+	int len;
+	int request;		//cd_request this was read for
+} cdslot_t;
+
+static char *cd_ring;			//CD_SLOTS*CD_READ_SZ, in PSRAM
+static cdslot_t cd_slots[CD_SLOTS];
+static int cd_wslot;			//slots filled, advanced by cd_task
+static int cd_rslot;			//slots drained, advanced by the audio task
+static int cd_rofs;				//audio task's position in slot cd_rslot
+static TaskHandle_t cd_reader;
 
 int CDAudio_Init(void)
 {
@@ -171,6 +191,8 @@ int CDAudio_Init(void)
 		printf("CDAudio_Init: couldn't find bin file %s\n", binfile);
 		return 0;
 	}
+	//reads are large already; don't copy them through a stdio buffer as well
+	setvbuf(cdfile, NULL, _IONBF, 0);
 	//Find size of bin file so we know the end of the last track
 	fseek(cdfile, 0, SEEK_END);
 	long cdsize=ftell(cdfile);
@@ -190,120 +212,159 @@ int CDAudio_Init(void)
 					tracks[i].length_bytes);
 	}
 
-	//Create the ringbuffer where the samples are dumped into and start the cd audio task.
-	ringbuf=xRingbufferCreateWithCaps(RINGBUF_SZ, RINGBUF_TYPE_BYTEBUF, MALLOC_CAP_SPIRAM);
-	assert(ringbuf);
-	player_ctl_mux=xSemaphoreCreateMutex();
-	xTaskCreatePinnedToCore(cd_task, "cdaudio", 4096, NULL, 4, NULL, 1);
+	//Create the ring the samples are read into and start the cd audio task.
+	cd_ring=heap_caps_malloc(CD_SLOTS*CD_READ_SZ, MALLOC_CAP_SPIRAM);
+	assert(cd_ring);
+	xTaskCreatePinnedToCore(cd_task, "cdaudio", 4096, NULL, 4, &cd_reader, 1);
 	return 1;
 }
 
 
 #define STATE_STOPPED 0
 #define STATE_PLAYING 1
-#define STATE_PLAYNEW 2
 #define STATE_SHUTDOWN 3
 
 static int state;
 static int cd_track;
 static int cd_looping;
+static int cd_request;		//bumped by every CDAudio_Play, after cd_track and cd_looping are set
 
-//Read samples from the current CD track into a buffer.
+//Read samples from the current CD track into a buffer. Called from the audio task; never blocks.
 void CDAudio_get_samps(char *samps, int len_bytes) {
-	size_t recv_size=0;
-	if (!ringbuf) {
-		//not initialized (yet?) so output silence
+	if (!cd_ring || __atomic_load_n(&state, __ATOMIC_ACQUIRE)!=STATE_PLAYING) {
+		//not initialized (yet?), stopped or paused, so output silence
 		memset(samps, 0, len_bytes);
 		return; 
 	}
-	while (len_bytes) {
-		char *item=xRingbufferReceiveUpTo(ringbuf, &recv_size, portMAX_DELAY, len_bytes);
-		assert(recv_size<=len_bytes);
-		memcpy(samps, item, recv_size);
-		vRingbufferReturnItem(ringbuf, item);
-		samps+=recv_size;
-		len_bytes-=recv_size;
+	int req=__atomic_load_n(&cd_request, __ATOMIC_ACQUIRE);
+	int w=__atomic_load_n(&cd_wslot, __ATOMIC_ACQUIRE);
+	int r=cd_rslot;
+	while (len_bytes && r!=w) {
+		cdslot_t *slot=&cd_slots[r%CD_SLOTS];
+		if (slot->request!=req) {
+			//left over from a track we're no longer playing
+			r++;
+			cd_rofs=0;
+			continue;
+		}
+		int n=slot->len-cd_rofs;
+		if (n>len_bytes) n=len_bytes;
+		memcpy(samps, cd_ring+(r%CD_SLOTS)*CD_READ_SZ+cd_rofs, n);
+		samps+=n;
+		len_bytes-=n;
+		cd_rofs+=n;
+		if (cd_rofs==slot->len) {
+			r++;
+			cd_rofs=0;
+		}
+	}
+	if (r!=cd_rslot) {
+		__atomic_store_n(&cd_rslot, r, __ATOMIC_RELEASE);
+		xTaskNotifyGive(cd_reader);
 	}
+	//underrun: the reader is behind, play silence rather than wait for it
+	if (len_bytes) memset(samps, 0, len_bytes);
 }
 
 void cd_task(void *param) {
-	int size=RINGBUF_SZ/4; //we read in chunks this big
-	char *item=malloc(size);
-	while(state!=STATE_SHUTDOWN) {
-		xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
-		if (state==STATE_STOPPED) { //or paused
-			//output silence
-			memset(item, 0, size);
-		} else {
-			if (state==STATE_PLAYNEW) {
-				state=STATE_PLAYING;
-				printf("CD: Changing to track %d (looping %d)\n", cd_track, cd_looping);
-				fseek(cdfile, tracks[cd_track].offset_bytes, SEEK_SET);
+	int request=-1;		//the play request being read
+	int track=0, looping=0, reading=0;
+	long pos=0, end=0, filepos=-1;
+	while(__atomic_load_n(&state, __ATOMIC_ACQUIRE)!=STATE_SHUTDOWN) {
+		int req=__atomic_load_n(&cd_request, __ATOMIC_ACQUIRE);
+		if (req!=request) {
+			request=req;
+			track=cd_track;
+			looping=cd_looping;
+			reading=(track>=0 && track<MAX_TRK && tracks[track].type!=TYPE_NONE);
+			if (reading) {
+				printf("CD: Changing to track %d (looping %d)\n", track, looping);
+				pos=tracks[track].offset_bytes;
+				end=pos+tracks[track].length_bytes;
 			}
-			fread(item, size, 1, cdfile);
-			long pos=ftell(cdfile);
-			//printf("CD: %d\n", pos);
-			assert((pos%CD_FRAME_SIZE)==0);
-			if (pos > tracks[cd_track].offset_bytes+tracks[cd_track].length_bytes) {
-				if (cd_looping) {
-					printf("End of track. Looping.\n");
-					fseek(cdfile, tracks[cd_track].offset_bytes, SEEK_SET);
-				} else {
-					cd_track++;
-					printf("End of track. Next track %d.\n", cd_track);
-					if (tracks[cd_track].type==TYPE_NONE) state=STATE_STOPPED;
+		}
+		if (!reading || cd_wslot-__atomic_load_n(&cd_rslot, __ATOMIC_ACQUIRE)>=CD_SLOTS) {
+			//nothing to do until a slot frees up or a new track is asked for
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+			continue;
+		}
+
+		//read up to the next CD_READ_SZ boundary in the file, or the end of the track
+		int len=CD_READ_SZ-(pos%CD_READ_SZ);
+		if (len>end-pos) len=end-pos;
+		if (filepos!=pos) fseek(cdfile, pos, SEEK_SET);
+		len=fread(cd_ring+(cd_wslot%CD_SLOTS)*CD_READ_SZ, 1, len, cdfile);
+		if (len<=0) {
+			printf("CD: read error at %ld\n", pos);
+			reading=0;
+			filepos=-1;
+			continue;
+		}
+		pos+=len;
+		filepos=pos;
+		cd_slots[cd_wslot%CD_SLOTS].len=len;
+		cd_slots[cd_wslot%CD_SLOTS].request=request;
+		__atomic_store_n(&cd_wslot, cd_wslot+1, __ATOMIC_RELEASE);
+
+		if (pos>=end) {
+			if (!looping) {
+				track++;
+				printf("End of track. Next track %d.\n", track);
+				if (track>=MAX_TRK || tracks[track].type==TYPE_NONE) {
+					reading=0;
+					continue;
 				}
+			} else {
+				printf("End of track. Looping.\n");
 			}
+			pos=tracks[track].offset_bytes;
+			end=pos+tracks[track].length_bytes;
 		}
-		xSemaphoreGive(player_ctl_mux);
-		xRingbufferSend(ringbuf, item, size, portMAX_DELAY);
 	}
 	fclose(cdfile);
-	free(item);
 	vTaskDelete(NULL);
 }
 
+static void cd_set_state(int newstate) {
+	__atomic_store_n(&state, newstate, __ATOMIC_RELEASE);
+	xTaskNotifyGive(cd_reader);
+}
+
 void CDAudio_Shutdown(void)
 {
-	state=STATE_SHUTDOWN;
+	if (!cdfile) return;
+	cd_set_state(STATE_SHUTDOWN);
 }
 
 
 void CDAudio_Play(byte track, qboolean looping) {
 	if (!cdfile) return;
-	xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
-	state=STATE_PLAYNEW;
 	cd_track=track;
 	cd_looping=looping;
+	__atomic_add_fetch(&cd_request, 1, __ATOMIC_RELEASE);
 	printf("CD: Playing\n");
-	xSemaphoreGive(player_ctl_mux);
+	cd_set_state(STATE_PLAYING);
 }
 
 
 void CDAudio_Stop(void) {
 	if (!cdfile) return;
-	xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
-	state=STATE_STOPPED;
 	printf("CD: Stopping\n");
-	xSemaphoreGive(player_ctl_mux);
+	cd_set_state(STATE_STOPPED);
 }
 
 
 void CDAudio_Pause(void) {
 	if (!cdfile) return;
-	xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
-	state=STATE_STOPPED;
 	printf("CD: Pausing\n");
-	xSemaphoreGive(player_ctl_mux);
+	cd_set_state(STATE_STOPPED);
 }
 
 
 void CDAudio_Resume(void) {
 	if (!cdfile) return;
-	xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
-	state=STATE_PLAYING;
 	printf("CD: Resuming\n");
-	xSemaphoreGive(player_ctl_mux);
+	cd_set_state(STATE_PLAYING);
 }
 
 
@@ -36,7 +36,17 @@ esp_lcd_panel_handle_t panel_handle = NULL;
 esp_lcd_panel_io_handle_t io_handle = NULL;
 
 
-static uint16_t pal[256];
+//Palettes are versioned so that a palette change can never land halfway
+//through converting a frame: each submitted frame carries the palette that
+//was current when it was submitted, and a new palette is always written into
+//a slot that neither the pending frame nor the one being converted uses.
+#define PAL_SLOTS 3
+static uint16_t pal_slot[PAL_SLOTS][256];
+static int pal_latest=0;	//newest complete palette
+static int pal_frame=0;		//palette of cur_pixels
+static int pal_inuse=0;		//palette draw_task is converting with
+static portMUX_TYPE pal_lock=portMUX_INITIALIZER_UNLOCKED;
+
 static uint8_t *cur_pixels;
 static uint16_t *lcdbuf[2]={};
 static int cur_buf=1;
@@ -51,6 +61,9 @@ static int64_t start_time_fps_meas;
 void QG_DrawFrame(void *pixels) {
 	xSemaphoreTake(drawing_mux, portMAX_DELAY);
 	cur_pixels=pixels;
+	taskENTER_CRITICAL(&pal_lock);
+	pal_frame=pal_latest;
+	taskEXIT_CRITICAL(&pal_lock);
 	xSemaphoreGive(drawing_mux);
 	xTaskNotifyGive(draw_task_handle);
 	fps_ticks++;
@@ -79,7 +92,11 @@ static void draw_task(void *param) {
 		
 		xSemaphoreTake(drawing_mux, portMAX_DELAY);
 		int64_t start_us = esp_timer_get_time();
+		taskENTER_CRITICAL(&pal_lock);
+		pal_inuse=pal_frame;
+		taskEXIT_CRITICAL(&pal_lock);
 		// convert pixels
+		const uint16_t *pal=pal_slot[pal_inuse];
 		uint8_t *p=(uint8_t*)cur_pixels;
 		uint16_t *lcdp=rgbfb;
 		for (int y=0; y<QUAKEGENERIC_RES_Y; y++) {
@@ -124,7 +141,26 @@ static void draw_task(void *param) {
 	}
 }
 
+//Returns a palette slot that no submitted frame refers to
+static uint16_t *pal_begin(int *slot) {
+	taskENTER_CRITICAL(&pal_lock);
+	int s=0;
+	while (s==pal_inuse || s==pal_frame) s++;
+	taskEXIT_CRITICAL(&pal_lock);
+	*slot=s;
+	return pal_slot[s];
+}
+
+//Makes the palette in the slot the one attached to the next frame
+static void pal_publish(int slot) {
+	taskENTER_CRITICAL(&pal_lock);
+	pal_latest=slot;
+	taskEXIT_CRITICAL(&pal_lock);
+}
+
 void QG_SetPalette(unsigned char palette[768]) {
+	int slot;
+	uint16_t *pal=pal_begin(&slot);
 	unsigned char *p=palette;
 	for (int i=0; i<256; i++) {
 		//convert to rgb565
@@ -133,6 +169,14 @@ void QG_SetPalette(unsigned char palette[768]) {
 		int r=(*p++)>>3;
 		pal[i]=r+(g<<5)+(b<<11);
 	}
+	pal_publish(slot);
+}
+
+void QG_SetPalette565(unsigned short palette[256]) {
+	int slot;
+	uint16_t *pal=pal_begin(&slot);
+	memcpy(pal, palette, 256*sizeof(uint16_t));
+	pal_publish(slot);
 }
 
 #define CHAR_W 8
@@ -149,7 +193,7 @@ static void draw_char(int x, int y, int ch, int fore, int back) {
 		for (int px=0; px<CHAR_W; px++) {
 			int pix=fontdata_8x16[ch*CHAR_H+py]&(1<<px);
 			int col=pix?fore:back;
-			fb[BSP_LCD_H_RES*(y+py)+(x+(7-px))]=pal[col];
+			fb[BSP_LCD_H_RES*(y+py)+(x+(7-px))]=pal_slot[pal_latest][col];
 		}
 	}
 }
@@ -0,0 +1 @@
+// Host stand-in: nothing in cd_cue.c needs the section attributes.
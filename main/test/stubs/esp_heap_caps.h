@@ -0,0 +1,9 @@
+// Host stand-in: every capability is plain malloc.
+#include <stdlib.h>
+
+#define MALLOC_CAP_SPIRAM (1<<10)
+
+static inline void *heap_caps_malloc(size_t size, unsigned caps) {
+	(void)caps;
+	return malloc(size);
+}
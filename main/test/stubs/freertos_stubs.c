@@ -0,0 +1,71 @@
+// Host implementation of the FreeRTOS calls cd_cue.c makes.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+struct host_task {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint32_t notified;
+	TaskFunction_t fn;
+	void *param;
+};
+
+static __thread struct host_task *cur_task;
+
+static void *task_trampoline(void *arg) {
+	struct host_task *t=arg;
+	cur_task=t;
+	t->fn(t->param);
+	return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+		void *param, UBaseType_t prio, TaskHandle_t *handle, BaseType_t core) {
+	struct host_task *t=calloc(1, sizeof(*t));
+	pthread_mutex_init(&t->lock, NULL);
+	pthread_cond_init(&t->cond, NULL);
+	t->fn=fn;
+	t->param=param;
+	if (handle) *handle=t;
+	if (pthread_create(&t->thread, NULL, task_trampoline, t)) return pdFALSE;
+	pthread_detach(t->thread);
+	return pdTRUE;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+	//only ever called by a task on itself
+	pthread_exit(NULL);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+	pthread_mutex_lock(&task->lock);
+	task->notified++;
+	pthread_cond_signal(&task->cond);
+	pthread_mutex_unlock(&task->lock);
+	return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+	struct host_task *t=cur_task;
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec+=ticks/1000;
+	ts.tv_nsec+=(long)(ticks%1000)*1000000;
+	if (ts.tv_nsec>=1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec-=1000000000;
+	}
+	pthread_mutex_lock(&t->lock);
+	while (!t->notified) {
+		if (pthread_cond_timedwait(&t->cond, &t->lock, &ts)) break;
+	}
+	uint32_t n=t->notified;
+	if (n) t->notified=clear?0:n-1;
+	pthread_mutex_unlock(&t->lock);
+	return n;
+}
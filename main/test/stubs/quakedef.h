@@ -0,0 +1,20 @@
+// Host stand-in for the engine header, carrying just what cd_cue.c uses.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define MAX_OSPATH 128
+
+typedef unsigned char byte;
+typedef enum {false, true} qboolean;
+
+typedef struct {
+	char *basedir;
+} quakeparms_t;
+
+extern quakeparms_t host_parms;
+extern int com_argc;
+extern char **com_argv;
+int COM_CheckParm(char *parm);
@@ -0,0 +1,269 @@
+// Host test for cd_cue.c: plays a synthetic cue/bin through the same ring and
+// request-tag code the firmware uses, with FreeRTOS replaced by pthreads (see
+// stubs/). Every byte of the bin is non-zero and depends on its file offset,
+// so whatever CDAudio_get_samps returns can be checked byte for byte, and
+// silence from an underrun is told apart from data by being zero.
+//
+// fread is wrapped (-Wl,--wrap=fread) so that the test can stall the reader
+// like a slow SD card would.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "quakedef.h"
+
+void CDAudio_get_samps(char *samps, int len_bytes);
+int CDAudio_Init(void);
+void CDAudio_Play(byte track, qboolean looping);
+void CDAudio_Stop(void);
+void CDAudio_Shutdown(void);
+
+quakeparms_t host_parms;
+int com_argc;
+char **com_argv;
+
+int COM_CheckParm(char *parm) {
+	return 0;
+}
+
+#define FRAME 2352
+//track 1 is data, 2 and 3 audio; none start or end on a 32K read boundary
+#define TRK2_FRAME 160
+#define TRK3_FRAME 225
+#define BIN_FRAMES 300
+#define BIN_SIZE (BIN_FRAMES*FRAME)
+#define TRK2_OFS (TRK2_FRAME*FRAME)
+#define TRK2_LEN ((TRK3_FRAME-TRK2_FRAME)*FRAME)
+#define TRK3_OFS (TRK3_FRAME*FRAME)
+#define TRK3_LEN ((BIN_FRAMES-TRK3_FRAME)*FRAME)
+
+#define CHUNK 2048		//what the audio task asks for at a time
+#define TIMEOUT_MS 5000
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+	if (!(cond)) { \
+		printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		failures++; \
+	} \
+} while (0)
+
+static byte bin_byte(long ofs) {
+	return ((ofs ^ (ofs>>8) ^ (ofs>>16)) % 255) + 1;
+}
+
+//Reader stall, to fake a card that stops answering
+static pthread_mutex_t stall_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stall_cond=PTHREAD_COND_INITIALIZER;
+static int stalled;
+
+size_t __real_fread(void *ptr, size_t size, size_t n, FILE *f);
+
+size_t __wrap_fread(void *ptr, size_t size, size_t n, FILE *f) {
+	pthread_mutex_lock(&stall_lock);
+	while (stalled) pthread_cond_wait(&stall_cond, &stall_lock);
+	pthread_mutex_unlock(&stall_lock);
+	return __real_fread(ptr, size, n, f);
+}
+
+static void set_stall(int on) {
+	pthread_mutex_lock(&stall_lock);
+	stalled=on;
+	pthread_cond_broadcast(&stall_cond);
+	pthread_mutex_unlock(&stall_lock);
+}
+
+static long now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000L+ts.tv_nsec/1000000;
+}
+
+static void make_disc(const char *dir) {
+	char fn[MAX_OSPATH];
+	sprintf(fn, "%s/game.cue", dir);
+	FILE *f=fopen(fn, "w");
+	assert(f);
+	fprintf(f, "FILE \"game.bin\" BINARY\n");
+	fprintf(f, "  TRACK 01 MODE1/2352\n");
+	fprintf(f, "    INDEX 01 00:00:00\n");
+	fprintf(f, "  TRACK 02 AUDIO\n");
+	fprintf(f, "    INDEX 01 00:%02d:%02d\n", TRK2_FRAME/75, TRK2_FRAME%75);
+	fprintf(f, "  TRACK 03 AUDIO\n");
+	fprintf(f, "    INDEX 01 00:%02d:%02d\n", TRK3_FRAME/75, TRK3_FRAME%75);
+	fclose(f);
+
+	sprintf(fn, "%s/game.bin", dir);
+	f=fopen(fn, "wb");
+	assert(f);
+	for (long i=0; i<BIN_SIZE; i++) fputc(bin_byte(i), f);
+	fclose(f);
+}
+
+//Pull len bytes of music, dropping silence, and check they continue the track
+//at bin offset ofs..ofs+tlen from *pos on, wrapping when looping.
+static void expect_music(long ofs, long tlen, long *pos, long len, int looping) {
+	char buf[CHUNK];
+	long deadline=now_ms()+TIMEOUT_MS;
+	while (len) {
+		int n=len<CHUNK?len:CHUNK;
+		CDAudio_get_samps(buf, n);
+		int got=0;
+		for (int i=0; i<n; i++) {
+			if (!buf[i]) continue;
+			long at=ofs+*pos;
+			if ((byte)buf[i]!=bin_byte(at)) {
+				CHECK(0, "byte %ld of the track is %d, expected %d", *pos, (byte)buf[i], bin_byte(at));
+				return;
+			}
+			got++;
+			(*pos)++;
+			if (looping && *pos==tlen) *pos=0;
+		}
+		len-=got;
+		if (got<n) {
+			//underrun; give the reader a moment
+			if (now_ms()>deadline) {
+				CHECK(0, "timed out with %ld bytes still to come", len);
+				return;
+			}
+			usleep(1000);
+		}
+	}
+}
+
+//Nothing but silence for a while
+static void expect_silence(const char *what) {
+	char buf[CHUNK];
+	for (int j=0; j<50; j++) {
+		CDAudio_get_samps(buf, CHUNK);
+		for (int i=0; i<CHUNK; i++) {
+			if (buf[i]) {
+				CHECK(0, "%s: music where silence was expected", what);
+				return;
+			}
+		}
+		usleep(1000);
+	}
+}
+
+static void test_loop(void) {
+	long pos=0;
+	printf("-- looping track 2\n");
+	CDAudio_Play(2, true);
+	expect_music(TRK2_OFS, TRK2_LEN, &pos, TRK2_LEN*2+12345, 1);
+	CHECK(pos==12345, "looped to %ld", pos);
+}
+
+static void test_track_change(void) {
+	long pos=0;
+	printf("-- switching to track 3 mid-track\n");
+	CDAudio_Play(2, true);
+	expect_music(TRK2_OFS, TRK2_LEN, &pos, 50000, 1);
+	//whatever is still queued from track 2 must not be heard
+	pos=0;
+	CDAudio_Play(3, false);
+	expect_music(TRK3_OFS, TRK3_LEN, &pos, TRK3_LEN, 0);
+	//last track, not looping: the disc has ended
+	expect_silence("after the last track");
+}
+
+static void test_run_on(void) {
+	long pos=0;
+	printf("-- track 2 running on into track 3\n");
+	CDAudio_Play(2, false);
+	expect_music(TRK2_OFS, TRK2_LEN+TRK3_LEN, &pos, TRK2_LEN+TRK3_LEN, 0);
+	expect_silence("after the last track");
+}
+
+static void test_underrun(void) {
+	char buf[CHUNK];
+	long pos=0;
+	printf("-- underrun\n");
+	CDAudio_Play(2, true);
+	expect_music(TRK2_OFS, TRK2_LEN, &pos, 10000, 1);
+	set_stall(1);
+	//drain the ring; once it is dry every chunk must come back at once as silence
+	long deadline=now_ms()+TIMEOUT_MS;
+	while (1) {
+		long t=now_ms();
+		CDAudio_get_samps(buf, CHUNK);
+		int n;
+		for (n=0; n<CHUNK && buf[n]; n++) ;
+		for (int i=n; i<CHUNK; i++) {
+			if (buf[i]) {
+				CHECK(0, "music after silence within a chunk");
+				return;
+			}
+		}
+		for (int i=0; i<n; i++) {
+			if ((byte)buf[i]!=bin_byte(TRK2_OFS+pos)) {
+				CHECK(0, "byte %ld of the track is wrong while draining", pos);
+				return;
+			}
+			if (++pos==TRK2_LEN) pos=0;
+		}
+		if (n==0) {
+			CHECK(now_ms()-t<100, "a dry ring held up the audio task for %ld ms", now_ms()-t);
+			break;
+		}
+		if (now_ms()>deadline) {
+			CHECK(0, "ring never ran dry");
+			break;
+		}
+	}
+	expect_silence("while the reader is stalled");
+	//picks up where it left off once the card answers again
+	set_stall(0);
+	expect_music(TRK2_OFS, TRK2_LEN, &pos, TRK2_LEN, 1);
+}
+
+static void test_stop(void) {
+	long pos=0;
+	printf("-- stop\n");
+	CDAudio_Play(3, true);
+	expect_music(TRK3_OFS, TRK3_LEN, &pos, 1000, 1);
+	CDAudio_Stop();
+	expect_silence("after stop");
+}
+
+int main(int argc, char **argv) {
+	char dir[]="/tmp/cdcueXXXXXX";
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	make_disc(dir);
+	host_parms.basedir=dir;
+
+	CHECK(CDAudio_Init(), "no disc found");
+	if (failures) return 1;
+
+	test_loop();
+	test_track_change();
+	test_run_on();
+	test_underrun();
+	test_stop();
+
+	CDAudio_Shutdown();
+
+	char fn[MAX_OSPATH];
+	sprintf(fn, "%s/game.cue", dir);
+	unlink(fn);
+	sprintf(fn, "%s/game.bin", dir);
+	unlink(fn);
+	rmdir(dir);
+
+	if (failures) {
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("all cd_cue tests passed\n");
+	return 0;
+}